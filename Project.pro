@@ -8,16 +8,48 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+CONFIG   += c++11 thread
+
+# Keep SIMD color conversion kernels bit-identical to the scalar ones and let
+# the HSV kernels vectorize (see simd.h).
+QMAKE_CXXFLAGS += -ffp-contract=off -fno-trapping-math
+
 TARGET = Project
 TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        mainwindow.cpp
+        mainwindow.cpp \
+        imagecache.cpp \
+        directoryscanner.cpp \
+        thumbnailcache.cpp
 
 HEADERS  += mainwindow.h \
+    imagecache.h \
+    directoryscanner.h \
+    thumbnailcache.h \
     ../Documents/sense-ml-new/image_impl.h \
-    ../Documents/sense-ml-new/image.h
+    ../Documents/sense-ml-new/image.h \
+    ../Documents/sense-ml-new/resample_impl.h \
+    ../Documents/sense-ml-new/resample.h \
+    ../Documents/sense-ml-new/simd_impl.h \
+    ../Documents/sense-ml-new/simd.h \
+    ../Documents/sense-ml-new/parallel_impl.h \
+    ../Documents/sense-ml-new/parallel.h \
+    ../Documents/sense-ml-new/batch_impl.h \
+    ../Documents/sense-ml-new/batch.h \
+    ../Documents/sense-ml-new/native_impl.h \
+    ../Documents/sense-ml-new/native.h \
+    ../Documents/sense-ml-new/histogram_impl.h \
+    ../Documents/sense-ml-new/histogram.h \
+    ../Documents/sense-ml-new/integral_impl.h \
+    ../Documents/sense-ml-new/integral.h \
+    ../Documents/sense-ml-new/components_impl.h \
+    ../Documents/sense-ml-new/components.h \
+    ../Documents/sense-ml-new/pyramid_impl.h \
+    ../Documents/sense-ml-new/pyramid.h \
+    ../Documents/sense-ml-new/filter_impl.h \
+    ../Documents/sense-ml-new/filter.h
 
 FORMS    += mainwindow.ui
 
@@ -0,0 +1,83 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <armadillo>
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+// The functions below apply the function of the same name to every image of
+// a batch given as a vector. Images are handed out one at a time to
+// parallelWorkers() threads, and each image is processed by a single thread;
+// batches with fewer images than threads are processed one image at a time,
+// each image using all threads.
+//
+// Output vectors are resized to the size of the batch. Their images keep
+// their planes, so passing the same output vector for consecutive batches of
+// frames of the same size reuses the planes instead of allocating new ones.
+// Scratch buffers (decoded RGB images, filter weights and scratch planes) are
+// kept per worker for the whole batch.
+//
+// Functions returning bool return true if the function succeeded for every
+// image. Images it failed for are left empty.
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to load batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+// Load images of any color space (decoded into a scratch RGB image and
+// converted), grayscale Mat<eT> images or ImagePacked images.
+
+template<class ImageT>
+bool load(vector<ImageT>& images, const vector<string>& paths);
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+// Convert between any two image types convert() accepts, e.g. ImageRGB<eT>
+// to ImageLAB<eT>, ImageHSV<eT> to Mat<eT> or ImagePacked to ImageRGB<eT>.
+
+template<class ImageOut, class ImageIn>
+void convert(vector<ImageOut>& imagesOut, const vector<ImageIn>& imagesIn);
+
+template<class ImageOut, class ImageIn>
+void convert(vector<ImageOut>& imagesOut, const vector<ImageIn>& imagesIn, const ConversionMode mode);
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to resize, crop and threshold batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+// Resize ImageRGB<eT> or Mat<eT> images to the same size.
+
+template<class ImageT>
+bool resize(vector<ImageT>& imagesOut, const vector<ImageT>& imagesIn,
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+// Crop the same region of ImageRGB<eT> or Mat<eT> images.
+
+template<class ImageT>
+bool crop(vector<ImageT>& imagesOut, const vector<ImageT>& imagesIn,
+          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width);
+
+// Threshold Mat<eT> images.
+
+template<typename eT>
+bool threshold(vector<Mat<eT> >& matsOut, const vector<Mat<eT> >& matsIn,
+               const eT cutoff, const eT belowCutoffValue = 0, const eT aboveCutoffValue = 255);
+
+}  /* namespace sense */
+
+#include "batch_impl.h"
+
+#endif  /* __BATCH_H__ */
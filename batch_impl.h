@@ -0,0 +1,118 @@
+#include <atomic>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Load a single image of a batch. Images that are not decoded directly are
+// decoded into the scratch image of the worker and converted.
+template<class ImageT, typename eT>
+bool loadImage(ImageT& image, ImageRGB<eT>& scratch, const string& path) {
+  if (!load(scratch, path))
+    return false;
+  convert(image, scratch);
+  return true;
+}
+
+template<typename eT>
+bool loadImage(ImageRGB<eT>& image, ImageRGB<eT>&, const string& path) {
+  return load(image, path);
+}
+
+template<typename eT>
+bool loadImage(Mat<eT>& mat, ImageRGB<eT>&, const string& path) {
+  return load(mat, path);
+}
+
+inline bool loadImage(ImagePacked& image, ImageRGB<u8>&, const string& path) {
+  return load(image, path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to load batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class ImageT>
+bool load(vector<ImageT>& images, const vector<string>& paths) {
+  images.resize(paths.size());
+  vector<ImageRGB<typename ImageT::elem_type> > scratch(parallelWorkers(paths.size()));
+  atomic<bool> success(true);
+  parallelForEach(paths.size(), [&](const u32 worker, const uword i) {
+    if (!loadImage(images[i], scratch[worker], paths[i])) {
+      images[i] = ImageT();
+      success = false;
+    }
+  });
+  return success;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class ImageOut, class ImageIn>
+void convert(vector<ImageOut>& imagesOut, const vector<ImageIn>& imagesIn) {
+  imagesOut.resize(imagesIn.size());
+  parallelForEach(imagesIn.size(), [&](const u32, const uword i) {
+    convert(imagesOut[i], imagesIn[i]);
+  });
+}
+
+template<class ImageOut, class ImageIn>
+void convert(vector<ImageOut>& imagesOut, const vector<ImageIn>& imagesIn, const ConversionMode mode) {
+  imagesOut.resize(imagesIn.size());
+  parallelForEach(imagesIn.size(), [&](const u32, const uword i) {
+    convert(imagesOut[i], imagesIn[i], mode);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to resize, crop and threshold batches of images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class ImageT>
+bool resize(vector<ImageT>& imagesOut, const vector<ImageT>& imagesIn,
+            const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  imagesOut.resize(imagesIn.size());
+  vector<Resizer<typename ImageT::elem_type> > resizers(parallelWorkers(imagesIn.size()));
+  atomic<bool> success(true);
+  parallelForEach(imagesIn.size(), [&](const u32 worker, const uword i) {
+    if (!resize(resizers[worker], imagesOut[i], imagesIn[i], height, width, filter)) {
+      imagesOut[i] = ImageT();
+      success = false;
+    }
+  });
+  return success;
+}
+
+template<class ImageT>
+bool crop(vector<ImageT>& imagesOut, const vector<ImageT>& imagesIn,
+          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
+  imagesOut.resize(imagesIn.size());
+  atomic<bool> success(true);
+  parallelForEach(imagesIn.size(), [&](const u32, const uword i) {
+    if (!crop(imagesOut[i], imagesIn[i], yOffset, xOffset, height, width)) {
+      imagesOut[i] = ImageT();
+      success = false;
+    }
+  });
+  return success;
+}
+
+template<typename eT>
+bool threshold(vector<Mat<eT> >& matsOut, const vector<Mat<eT> >& matsIn,
+               const eT cutoff, const eT belowCutoffValue /* default: 0 */, const eT aboveCutoffValue /* default: 255 */) {
+  matsOut.resize(matsIn.size());
+  atomic<bool> success(true);
+  parallelForEach(matsIn.size(), [&](const u32, const uword i) {
+    if (!threshold(matsOut[i], matsIn[i], cutoff, belowCutoffValue, aboveCutoffValue)) {
+      matsOut[i] = Mat<eT>();
+      success = false;
+    }
+  });
+  return success;
+}
+
+}  /* namespace sense */
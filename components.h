@@ -0,0 +1,82 @@
+#ifndef __COMPONENTS_H__
+#define __COMPONENTS_H__
+
+#include <armadillo>
+#include <vector>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Connected components.
+////////////////////////////////////////////////////////////////////////////////
+
+// Pixels of a mask (e.g. the output of threshold()) whose value is not 0 are
+// foreground. Connected foreground pixels form a component; 8-connected
+// pixels also touch diagonally, 4-connected ones only vertically and
+// horizontally.
+
+enum Connectivity {
+  CONNECTIVITY_4 = 4,
+  CONNECTIVITY_8 = 8
+};
+
+// Statistics of a component. The bounding box is given as the arguments of
+// crop(), and the centroid is the mean position of the pixels.
+
+struct Component {
+  uword area;  // Number of pixels
+  u32 yOffset;
+  u32 xOffset;
+  u32 height;
+  u32 width;
+  double y;  // Centroid
+  double x;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to label connected components.
+////////////////////////////////////////////////////////////////////////////////
+
+// Label the components of a mask, or of a region of one. labelsOut gets the
+// size of the mask, with 0 for background pixels and 1 - n for the pixels of
+// the n components, which are numbered in the order in which the first pass
+// below reaches them, column by column. componentsOut[i] holds the
+// statistics of the component labeled i + 1. Returns n.
+//
+// Labeling is done in two passes. The first assigns provisional labels to
+// blocks of pixels and records which touch in a union-find forest: 2x2
+// blocks for 8-connectivity, whose foreground pixels are always connected to
+// each other, and single pixels for 4-connectivity. It runs in parallel over
+// bands of columns, after which the labels on either side of each boundary
+// between bands are merged. The second pass writes the final labels and adds
+// up the statistics, in parallel over bands of columns with statistics of
+// their own. The result does not depend on the number of threads.
+
+template<typename eT>
+u32 label(Mat<u32>& labelsOut, vector<Component>& componentsOut, const Mat<eT>& maskIn,
+          const Connectivity connectivity = CONNECTIVITY_8);
+
+template<typename eT>
+u32 label(Mat<u32>& labelsOut, vector<Component>& componentsOut, const MatRoi<eT>& maskIn,
+          const Connectivity connectivity = CONNECTIVITY_8);
+
+// The same, for the statistics only.
+
+template<typename eT>
+u32 components(vector<Component>& componentsOut, const Mat<eT>& maskIn,
+               const Connectivity connectivity = CONNECTIVITY_8);
+
+template<typename eT>
+u32 components(vector<Component>& componentsOut, const MatRoi<eT>& maskIn,
+               const Connectivity connectivity = CONNECTIVITY_8);
+
+}  /* namespace sense */
+
+#include "components_impl.h"
+
+#endif  /* __COMPONENTS_H__ */
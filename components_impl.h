@@ -0,0 +1,298 @@
+#ifndef __COMPONENTS_IMPL_H__
+#define __COMPONENTS_IMPL_H__
+
+#include <algorithm>
+#include <mutex>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Union-find forest of provisional labels. The root of a tree is always its
+// smallest label, so every label points to a smaller one and the trees can be
+// flattened in a single pass in increasing order.
+
+SENSE_FORCE_INLINE u32 findRoot(u32* parent, u32 label) {
+  while (parent[label] != label) {
+    parent[label] = parent[parent[label]];
+    label = parent[label];
+  }
+  return label;
+}
+
+SENSE_FORCE_INLINE void unite(u32* parent, const u32 label0, const u32 label1) {
+  const u32 root0 = findRoot(parent, label0);
+  const u32 root1 = findRoot(parent, label1);
+  if (root0 < root1)
+    parent[root1] = root0;
+  else
+    parent[root0] = root1;
+}
+
+// Grid of the blocks (cells) of cell x cell pixels of a mask, with the
+// provisional label of each cell (0 for cells without foreground pixels).
+// With cell = 2 (8-connectivity) the foreground pixels of a cell are all
+// connected to each other; with cell = 1 (4-connectivity) a cell is a pixel.
+template<typename eT, u32 cell>
+class CellGrid {
+  public:
+    const MatRoi<eT>& mask;
+    Mat<u32>& labels;
+    u32 rows;
+    u32 cols;
+
+    CellGrid(const MatRoi<eT>& mask, Mat<u32>& labels)
+      : mask(mask), labels(labels),
+        rows((mask.height + cell - 1) / cell), cols((mask.width + cell - 1) / cell) {
+      labels.set_size(rows, cols);
+    }
+
+    SENSE_FORCE_INLINE bool pixel(const u32 y, const u32 x) const {
+      return (y < mask.height && x < mask.width && mask.colptr(x)[y] != 0);
+    }
+
+    bool occupied(const u32 cy, const u32 cx) const {
+      if (cell == 1)
+        return pixel(cy, cx);
+      const u32 y = cy * cell;
+      const u32 x = cx * cell;
+      return (pixel(y, x) || pixel(y + 1, x) || pixel(y, x + 1) || pixel(y + 1, x + 1));
+    }
+
+    // Label of the occupied cell above (cy, cx) if the two are connected, or
+    // 0.
+    u32 above(const u32 cy, const u32 cx) const {
+      if (cy == 0 || labels.at(cy - 1, cx) == 0)
+        return 0;
+      if (cell == 1)
+        return labels.at(cy - 1, cx);
+      const u32 y = cy * cell;
+      const u32 x = cx * cell;
+      if ((pixel(y, x) || pixel(y, x + 1)) && (pixel(y - 1, x) || pixel(y - 1, x + 1)))
+        return labels.at(cy - 1, cx);
+      return 0;
+    }
+
+    // Call f(label) for every occupied cell of column cx - 1 connected to
+    // the occupied cell (cy, cx).
+    template<class Function>
+    void left(const u32 cy, const u32 cx, const Function& f) const {
+      const u32* previous = labels.colptr(cx - 1);
+      if (cell == 1) {
+        if (previous[cy] != 0)
+          f(previous[cy]);
+        return;
+      }
+      const u32 y = cy * cell;
+      const u32 x = cx * cell;
+      if (previous[cy] != 0 && (pixel(y, x) || pixel(y + 1, x)) && (pixel(y, x - 1) || pixel(y + 1, x - 1)))
+        f(previous[cy]);
+      if (cy > 0 && previous[cy - 1] != 0 && pixel(y, x) && pixel(y - 1, x - 1))
+        f(previous[cy - 1]);
+      if (cy + 1 < rows && previous[cy + 1] != 0 && pixel(y + 1, x) && pixel(y + 2, x - 1))
+        f(previous[cy + 1]);
+    }
+};
+
+// First pass over the cell columns begin - end - 1. Provisional labels of the
+// band start at begin * rows + 1, so that bands never share labels; returns
+// the label after the last one used.
+template<typename eT, u32 cell>
+u32 labelCells(CellGrid<eT, cell>& grid, u32* parent, const u32 begin, const u32 end) {
+  u32 next = begin * grid.rows + 1;
+  for (u32 cx = begin; cx < end; cx++) {
+    u32* out = grid.labels.colptr(cx);
+    for (u32 cy = 0; cy < grid.rows; cy++) {
+      if (!grid.occupied(cy, cx)) {
+        out[cy] = 0;
+        continue;
+      }
+      u32 label = grid.above(cy, cx);
+      if (cx > begin) {
+        grid.left(cy, cx, [&](const u32 neighbor) {
+          if (label == 0)
+            label = neighbor;
+          else
+            unite(parent, label, neighbor);
+        });
+      }
+      if (label == 0) {
+        label = next++;
+        parent[label] = label;
+      }
+      out[cy] = label;
+    }
+  }
+  return next;
+}
+
+// Running sums of the statistics of a component.
+struct ComponentSums {
+  uword area;
+  u64 sumY;
+  u64 sumX;
+  u32 yMin;
+  u32 yMax;
+  u32 xMin;
+  u32 xMax;
+  ComponentSums() : area(0), sumY(0), sumX(0), yMin(~0u), yMax(0), xMin(~0u), xMax(0) {}
+
+  SENSE_FORCE_INLINE void add(const u32 y, const u32 x) {
+    area++;
+    sumY += y;
+    sumX += x;
+    yMin = std::min(yMin, y);
+    yMax = std::max(yMax, y);
+    xMin = std::min(xMin, x);
+    xMax = std::max(xMax, x);
+  }
+
+  void add(const ComponentSums& sums) {
+    area += sums.area;
+    sumY += sums.sumY;
+    sumX += sums.sumX;
+    yMin = std::min(yMin, sums.yMin);
+    yMax = std::max(yMax, sums.yMax);
+    xMin = std::min(xMin, sums.xMin);
+    xMax = std::max(xMax, sums.xMax);
+  }
+};
+
+template<typename eT, u32 cell>
+u32 labelComponents(Mat<u32>* labelsOut, vector<Component>& componentsOut, const MatRoi<eT>& maskIn) {
+  Mat<u32> cellLabels;
+  CellGrid<eT, cell> grid(maskIn, cellLabels);
+  const u32 rows = grid.rows;
+  const u32 cols = grid.cols;
+
+  // First pass. bandEnds[cx] is the end of the labels of the band starting at
+  // cell column cx, or 0 if no band starts there.
+  vector<u32> parent((uword)rows * cols + 1);
+  vector<u32> bandEnds(cols, 0);
+  parallelFor(cols, std::max(minTileLines(maskIn.height) / cell, (uword)1), [&](const uword begin, const uword end) {
+    bandEnds[begin] = labelCells(grid, parent.data(), (u32)begin, (u32)end);
+  });
+
+  // Merge the labels across the boundaries between bands, then replace each
+  // label by its final label, numbering the roots in increasing order.
+  for (u32 cx = 1; cx < cols; cx++) {
+    if (bandEnds[cx] == 0)
+      continue;
+    const u32* out = cellLabels.colptr(cx);
+    for (u32 cy = 0; cy < rows; cy++) {
+      if (out[cy] != 0)
+        grid.left(cy, cx, [&](const u32 neighbor) { unite(parent.data(), out[cy], neighbor); });
+    }
+  }
+  u32 count = 0;
+  for (u32 cx = 0; cx < cols; cx++) {
+    for (u32 label = cx * rows + 1; label < bandEnds[cx]; label++)
+      parent[label] = (parent[label] == label) ? ++count : parent[parent[label]];
+  }
+
+  // Second pass.
+  if (labelsOut != NULL) {
+    labelsOut->set_size(maskIn.height, maskIn.width);
+    labelsOut->zeros();
+  }
+  vector<ComponentSums> sums(count);
+  mutex sumsLock;
+  parallelFor(cols, std::max(minTileLines(maskIn.height) / cell, (uword)1), [&](const uword begin, const uword end) {
+    // Sums of the range of final labels found in the band only, as a band
+    // usually touches a small part of the components.
+    u32 labelMin = count + 1;
+    u32 labelMax = 0;
+    for (u32 cx = (u32)begin; cx < end; cx++) {
+      const u32* in = cellLabels.colptr(cx);
+      for (u32 cy = 0; cy < rows; cy++) {
+        if (in[cy] == 0)
+          continue;
+        labelMin = std::min(labelMin, parent[in[cy]]);
+        labelMax = std::max(labelMax, parent[in[cy]]);
+      }
+    }
+    if (labelMax == 0)
+      return;
+
+    vector<ComponentSums> bandSums(labelMax - labelMin + 1);
+    for (u32 cx = (u32)begin; cx < end; cx++) {
+      const u32* in = cellLabels.colptr(cx);
+      for (u32 cy = 0; cy < rows; cy++) {
+        if (in[cy] == 0)
+          continue;
+        const u32 label = parent[in[cy]];
+        for (u32 x = cx * cell; x < cx * cell + cell; x++) {
+          for (u32 y = cy * cell; y < cy * cell + cell; y++) {
+            if (!grid.pixel(y, x))
+              continue;
+            bandSums[label - labelMin].add(y, x);
+            if (labelsOut != NULL)
+              labelsOut->at(y, x) = label;
+          }
+        }
+      }
+    }
+    lock_guard<mutex> guard(sumsLock);
+    for (u32 label = labelMin; label <= labelMax; label++)
+      sums[label - 1].add(bandSums[label - labelMin]);
+  });
+
+  componentsOut.resize(count);
+  for (u32 i = 0; i < count; i++) {
+    Component& component = componentsOut[i];
+    component.area = sums[i].area;
+    component.yOffset = sums[i].yMin;
+    component.xOffset = sums[i].xMin;
+    component.height = sums[i].yMax - sums[i].yMin + 1;
+    component.width = sums[i].xMax - sums[i].xMin + 1;
+    component.y = (double)sums[i].sumY / sums[i].area;
+    component.x = (double)sums[i].sumX / sums[i].area;
+  }
+  return count;
+}
+
+template<typename eT>
+u32 labelComponents(Mat<u32>* labelsOut, vector<Component>& componentsOut, const MatRoi<eT>& maskIn,
+                    const Connectivity connectivity) {
+  if ((uword)maskIn.height * maskIn.width >= 0xffffffffu)
+    throw logic_error("Masks must have fewer than 2^32 - 1 pixels");
+  switch (connectivity) {
+    case CONNECTIVITY_4: return labelComponents<eT, 1>(labelsOut, componentsOut, maskIn);
+    case CONNECTIVITY_8: return labelComponents<eT, 2>(labelsOut, componentsOut, maskIn);
+    default:             throw logic_error("Unknown connectivity");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to label connected components.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+u32 label(Mat<u32>& labelsOut, vector<Component>& componentsOut, const Mat<eT>& maskIn,
+          const Connectivity connectivity /* default: CONNECTIVITY_8 */) {
+  return labelComponents(&labelsOut, componentsOut, MatRoi<eT>(maskIn), connectivity);
+}
+
+template<typename eT>
+u32 label(Mat<u32>& labelsOut, vector<Component>& componentsOut, const MatRoi<eT>& maskIn,
+          const Connectivity connectivity /* default: CONNECTIVITY_8 */) {
+  return labelComponents(&labelsOut, componentsOut, maskIn, connectivity);
+}
+
+template<typename eT>
+u32 components(vector<Component>& componentsOut, const Mat<eT>& maskIn,
+               const Connectivity connectivity /* default: CONNECTIVITY_8 */) {
+  return labelComponents<eT>(NULL, componentsOut, MatRoi<eT>(maskIn), connectivity);
+}
+
+template<typename eT>
+u32 components(vector<Component>& componentsOut, const MatRoi<eT>& maskIn,
+               const Connectivity connectivity /* default: CONNECTIVITY_8 */) {
+  return labelComponents<eT>(NULL, componentsOut, maskIn, connectivity);
+}
+
+}  /* namespace sense */
+
+#endif  /* __COMPONENTS_IMPL_H__ */
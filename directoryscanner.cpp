@@ -0,0 +1,148 @@
+#include "directoryscanner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+
+//Files found are reported when this many have been collected, or after this
+//many milliseconds, so that the first ones show up at once
+static const int BATCH_FILES = 500;
+static const int BATCH_MS    = 100;
+
+//Delay between a change of the directory and its listing. Changes during the
+//delay do not postpone the listing, so a directory that keeps changing is
+//still listed every CHANGE_DELAY_MS
+static const int CHANGE_DELAY_MS = 500;
+
+
+DirectoryLister::DirectoryLister(QObject *parent) :
+    QObject(parent),
+    latestGeneration(0),
+    queued(false),
+    listedGeneration(-1)
+{
+}
+
+void DirectoryLister::setGeneration(int generation)
+{
+    latestGeneration = generation;
+}
+
+bool DirectoryLister::markQueued()
+{
+    return !queued.exchange(true);
+}
+
+void DirectoryLister::list(const QString &dirname, const QStringList &nameFilters, int generation)
+{
+    //Changes from now on need another listing
+    queued = false;
+    if(generation != latestGeneration)
+        return;
+    //Listings started by scan() report every file, even of the directory
+    //listed before; re-listings after a change only report new ones
+    if(generation != listedGeneration)
+    {
+        listedGeneration = generation;
+        listedNames.clear();
+    }
+
+    QStringList names;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    QDirIterator it(dirname, nameFilters, QDir::Files | QDir::NoDotAndDotDot);
+    while(it.hasNext())
+    {
+        //Abandon the listing when another directory is chosen
+        if(generation != latestGeneration)
+            return;
+
+        it.next();
+        const QString name = it.fileName();
+        if(listedNames.contains(name))
+            continue;
+        listedNames.insert(name);
+        names << name;
+
+        if(names.size() >= BATCH_FILES || batchTimer.elapsed() >= BATCH_MS)
+        {
+            emit filesFound(generation, names);
+            names.clear();
+            batchTimer.restart();
+        }
+    }
+    if(!names.isEmpty())
+        emit filesFound(generation, names);
+}
+
+DirectoryScanner::DirectoryScanner(QObject *parent) :
+    QObject(parent),
+    generation(0),
+    lister(new DirectoryLister)
+{
+    lister->moveToThread(&thread);
+    connect(lister, SIGNAL(filesFound(int,QStringList)), this, SLOT(filesFound(int,QStringList)));
+    connect(&watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged()));
+
+    changeTimer.setSingleShot(true);
+    changeTimer.setInterval(CHANGE_DELAY_MS);
+    connect(&changeTimer, SIGNAL(timeout()), this, SLOT(listDirectory()));
+
+    thread.start(QThread::LowPriority);
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    lister->setGeneration(-1);
+    thread.quit();
+    thread.wait();
+    delete lister;
+}
+
+void DirectoryScanner::setNameFilters(const QStringList &filters)
+{
+    nameFilters = filters;
+}
+
+void DirectoryScanner::scan(const QString &newDirname)
+{
+    if(!watcher.directories().isEmpty())
+        watcher.removePaths(watcher.directories());
+    changeTimer.stop();
+
+    dirname = newDirname;
+    generation++;
+    lister->setGeneration(generation);
+
+    watcher.addPath(dirname);
+    lister->markQueued();
+    queueListing();
+}
+
+void DirectoryScanner::directoryChanged()
+{
+    if(!changeTimer.isActive())
+        changeTimer.start();
+}
+
+void DirectoryScanner::listDirectory()
+{
+    //A listing that is queued but not started yet will also see this change
+    if(!lister->markQueued())
+        return;
+    queueListing();
+}
+
+void DirectoryScanner::queueListing()
+{
+    //Listings of the same directory are queued behind each other and report
+    //only files they have not reported yet
+    QMetaObject::invokeMethod(lister, "list", Qt::QueuedConnection,
+                              Q_ARG(QString, dirname), Q_ARG(QStringList, nameFilters), Q_ARG(int, generation));
+}
+
+void DirectoryScanner::filesFound(int foundGeneration, const QStringList &names)
+{
+    if(foundGeneration == generation)
+        emit filesAdded(names);
+}
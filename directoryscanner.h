@@ -0,0 +1,89 @@
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+
+// Lists the files of a directory on the thread it lives in, reporting them in
+// batches as they are found. Within a generation, files reported once are not
+// reported again, so listing the directory again reports only the files added
+// since; a new generation reports every file again.
+class DirectoryLister : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryLister(QObject *parent = 0);
+
+    // Abandon listings of generations other than this one. Thread-safe.
+    void setGeneration(int generation);
+
+    // Mark a listing as queued. Returns false if one is queued already and
+    // has not started yet. Thread-safe.
+    bool markQueued();
+
+public slots:
+    void list(const QString &dirname, const QStringList &nameFilters, int generation);
+
+signals:
+    void filesFound(int generation, const QStringList &names);
+
+private:
+    std::atomic<int> latestGeneration;
+    std::atomic<bool> queued;           // A listing is queued and not started
+    int              listedGeneration;  // Generation listedNames belongs to
+    QSet<QString>    listedNames;
+};
+
+// Scans a directory in the background and watches it for new files.
+// filesAdded() is emitted with the names of the files found, first while the
+// directory is being listed and then whenever files are added to it.
+//
+// QFileSystemWatcher does not tell which files changed, so every change
+// re-lists the whole directory, at most once every 500 ms however often it
+// changes, and only reports the names it has not reported yet. At most one
+// re-listing waits behind the running listing, so a directory that changes
+// faster than it can be listed is listed back to back rather than piling up
+// listings. On very large or remote directories each change still costs a
+// full listing.
+class DirectoryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryScanner(QObject *parent = 0);
+    ~DirectoryScanner();
+
+    // Name patterns of the files to report, matched case-insensitively
+    void setNameFilters(const QStringList &filters);
+
+    // Stop scanning the previous directory and scan dirname
+    void scan(const QString &dirname);
+
+signals:
+    void filesAdded(const QStringList &names);
+
+private slots:
+    void directoryChanged();
+    void listDirectory();
+    void filesFound(int generation, const QStringList &names);
+
+private:
+    void queueListing();
+
+    QStringList         nameFilters;
+    QString             dirname;
+    int                 generation;
+    QFileSystemWatcher  watcher;
+    QTimer              changeTimer;    // Coalesces bursts of changes
+    QThread             thread;
+    DirectoryLister    *lister;
+};
+
+#endif // DIRECTORYSCANNER_H
@@ -0,0 +1,178 @@
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include <armadillo>
+#include <type_traits>
+#include <vector>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Filter settings.
+////////////////////////////////////////////////////////////////////////////////
+
+// Values of the pixels outside the image, as seen by the filters.
+
+enum BorderMode {
+  BORDER_REPLICATE = 0,  // aaa|abcd|ddd
+  BORDER_REFLECT = 1,  // cb|abcd|cb
+  BORDER_CONSTANT = 2  // 0
+};
+
+// Gradient operators. Both are the product of a smoothing kernel (1 2 1 for
+// Sobel, 3 10 3 for Scharr) across the derivative and a central difference
+// (-1 0 1) along it, and are not normalized: a ramp rising by 1 per pixel
+// has a gradient of 8 (Sobel) or 32 (Scharr).
+
+enum GradientOperator {
+  GRADIENT_SOBEL = 0,
+  GRADIENT_SCHARR = 1
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Filter classes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Separable filtering engine working directly on Armadillo planes. A kernel of
+// 2r + 1 taps centered on each pixel is applied down the columns of the
+// input, into a scratch plane, and then across the columns into the output.
+// Both passes run in parallel over columns and add one tap at a time to
+// blocks of FILTER_BLOCK_ROWS rows held on the stack, so that the inner
+// loops are vectorizable multiply-adds over contiguous memory and stay in
+// cache whatever the size of the kernel.
+//
+// The input is only read by filterColumns() and the output only written by
+// filterRows(), so the output may be the input. The scratch plane is kept
+// between calls, so filtering many planes of the same size (e.g. the three
+// planes of an ImageRGB, or consecutive frames) does not reallocate.
+//
+// Integer planes are accumulated in float and rounded and saturated on
+// output; floating-point planes are accumulated in their own type and are not
+// clamped. Gradients of integer planes are float planes.
+
+template<typename eT>
+class Filter {
+  public:
+    typedef typename conditional<is_floating_point<eT>::value, eT, float>::type tT;
+    void filterColumns(const eT* in, const uword inStride, const u32 height, const u32 width,
+                       const vector<tT>& kernel, const BorderMode border);
+    template<typename oT>
+    void filterRows(oT* out, const uword outStride, const vector<tT>& kernel, const BorderMode border);
+  private:
+    Mat<tT> scratch;
+};
+
+// Element type of the gradients of planes of type eT.
+
+template<typename eT>
+struct GradientType {
+  typedef typename Filter<eT>::tT type;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to filter images.
+////////////////////////////////////////////////////////////////////////////////
+
+// Filter with the given kernels: yKernel down the columns and xKernel across
+// them. Kernels have an odd number of taps and are centered on the pixel.
+
+template<typename eT>
+void filter(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<double>& yKernel, const vector<double>& xKernel,
+            const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void filter(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const vector<double>& yKernel, const vector<double>& xKernel,
+            const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void filter(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+            const vector<double>& yKernel, const vector<double>& xKernel, const BorderMode border = BORDER_REFLECT);
+
+// Gaussian blur with standard deviation sigma, over 2 * ceil(3 * sigma) + 1
+// taps.
+
+template<typename eT>
+void gaussianBlur(Mat<eT>& matOut, const Mat<eT>& matIn, const double sigma,
+                  const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gaussianBlur(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const double sigma,
+                  const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gaussianBlur(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn, const double sigma,
+                  const BorderMode border = BORDER_REFLECT);
+
+// Mean of the 2 * radius + 1 x 2 * radius + 1 pixels centered on each pixel.
+
+template<typename eT>
+void boxBlur(Mat<eT>& matOut, const Mat<eT>& matIn, const u32 radius,
+             const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void boxBlur(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const u32 radius,
+             const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void boxBlur(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn, const u32 radius,
+             const BorderMode border = BORDER_REFLECT);
+
+// Gradients along x (across the columns, to the right) and y (down the
+// columns). The outputs must not be the input.
+
+template<typename eT>
+void gradient(Mat<typename GradientType<eT>::type>& dxOut, Mat<typename GradientType<eT>::type>& dyOut,
+              const Mat<eT>& matIn, const GradientOperator op = GRADIENT_SOBEL,
+              const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gradient(Mat<typename GradientType<eT>::type>& dxOut, Mat<typename GradientType<eT>::type>& dyOut,
+              const MatRoi<eT>& roiIn, const GradientOperator op = GRADIENT_SOBEL,
+              const BorderMode border = BORDER_REFLECT);
+
+// Magnitude and orientation of the gradient: sqrt(dx^2 + dy^2) and
+// atan2(dy, dx), in radians (-pi - pi, with y pointing down).
+
+template<typename eT>
+void gradientMagnitude(Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut,
+                       const Mat<eT>& matIn, const GradientOperator op = GRADIENT_SOBEL,
+                       const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gradientMagnitude(Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut,
+                       const MatRoi<eT>& roiIn, const GradientOperator op = GRADIENT_SOBEL,
+                       const BorderMode border = BORDER_REFLECT);
+
+// Filter with the given engine, which keeps its scratch plane for further
+// images of the same size.
+
+template<typename eT>
+void gaussianBlur(Filter<eT>& filter, Mat<eT>& matOut, const MatRoi<eT>& roiIn, const double sigma,
+                  const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void boxBlur(Filter<eT>& filter, Mat<eT>& matOut, const MatRoi<eT>& roiIn, const u32 radius,
+             const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gradient(Filter<eT>& filter, Mat<typename GradientType<eT>::type>& dxOut,
+              Mat<typename GradientType<eT>::type>& dyOut, const MatRoi<eT>& roiIn,
+              const GradientOperator op = GRADIENT_SOBEL, const BorderMode border = BORDER_REFLECT);
+
+template<typename eT>
+void gradientMagnitude(Filter<eT>& filter, Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut, const MatRoi<eT>& roiIn,
+                       const GradientOperator op = GRADIENT_SOBEL, const BorderMode border = BORDER_REFLECT);
+
+}  /* namespace sense */
+
+#include "filter_impl.h"
+
+#endif  /* __FILTER_H__ */
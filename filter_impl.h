@@ -0,0 +1,354 @@
+#ifndef __FILTER_IMPL_H__
+#define __FILTER_IMPL_H__
+
+#include <algorithm>
+#include <cmath>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Number of rows accumulated at a time by the filter passes.
+const u32 FILTER_BLOCK_ROWS = 256;
+
+// Index inside 0 - n - 1 of sample i of a line of n samples, or -1 for the
+// constant border.
+inline s64 borderIndex(s64 i, const s64 n, const BorderMode border) {
+  if (i >= 0 && i < n)
+    return i;
+  switch (border) {
+    case BORDER_REPLICATE:
+      return (i < 0) ? 0 : n - 1;
+    case BORDER_REFLECT:
+      if (n == 1)
+        return 0;
+      while (i < 0 || i >= n)
+        i = (i < 0) ? -i : 2 * (n - 1) - i;
+      return i;
+    default:
+      return -1;
+  }
+}
+
+template<typename tT>
+vector<tT> filterKernel(const vector<double>& kernel) {
+  if (kernel.size() % 2 != 1)
+    throw logic_error("Filter kernels need an odd number of taps");
+  return vector<tT>(kernel.begin(), kernel.end());
+}
+
+inline vector<double> gaussianKernel(const double sigma) {
+  if (!(sigma > 0))
+    throw logic_error("Gaussian blur needs a positive sigma");
+  const s32 radius = std::max((s32)ceil(3 * sigma), 1);
+  vector<double> kernel(2 * radius + 1);
+  double sum = 0;
+  for (s32 i = -radius; i <= radius; i++) {
+    kernel[i + radius] = exp(-0.5 * i * i / (sigma * sigma));
+    sum += kernel[i + radius];
+  }
+  for (uword i = 0; i < kernel.size(); i++)
+    kernel[i] /= sum;
+  return kernel;
+}
+
+inline vector<double> boxKernel(const u32 radius) {
+  return vector<double>(2 * radius + 1, 1.0 / (2 * radius + 1));
+}
+
+inline vector<double> smoothingKernel(const GradientOperator op) {
+  switch (op) {
+    case GRADIENT_SOBEL:  return {1, 2, 1};
+    case GRADIENT_SCHARR: return {3, 10, 3};
+    default:              throw logic_error("Unknown gradient operator");
+  }
+}
+
+inline vector<double> derivativeKernel() {
+  return {-1, 0, 1};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Filter implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void Filter<eT>::filterColumns(const eT* in, const uword inStride, const u32 height, const u32 width,
+                               const vector<tT>& kernel, const BorderMode border) {
+  scratch.set_size(height, width);
+  const s64 radius = (s64)kernel.size() / 2;
+  const s64 rows = height;
+  // Rows whose window lies inside the column.
+  const s64 innerBegin = std::min(radius, rows);
+  const s64 innerEnd = std::max(rows - radius, innerBegin);
+  tT* const scratchMem = scratch.memptr();
+
+  parallelFor(width, minTileLines(height), [&](const uword begin, const uword end) {
+    tT block[FILTER_BLOCK_ROWS];
+    for (uword x = begin; x < end; x++) {
+      const eT* SENSE_RESTRICT column = in + x * inStride;
+      tT* SENSE_RESTRICT out = scratchMem + x * height;
+
+      // Edges, one pixel at a time.
+      const auto edge = [&](const s64 y) {
+        tT sum = 0;
+        for (s64 k = 0; k < (s64)kernel.size(); k++) {
+          const s64 i = borderIndex(y + k - radius, rows, border);
+          if (i >= 0)
+            sum += kernel[k] * (tT)column[i];
+        }
+        out[y] = sum;
+      };
+      for (s64 y = 0; y < innerBegin; y++)
+        edge(y);
+      for (s64 y = innerEnd; y < rows; y++)
+        edge(y);
+
+      // Inside, one tap at a time over blocks of rows.
+      for (s64 y0 = innerBegin; y0 < innerEnd; y0 += FILTER_BLOCK_ROWS) {
+        const u32 n = (u32)std::min((s64)FILTER_BLOCK_ROWS, innerEnd - y0);
+        std::fill(block, block + n, (tT)0);
+        for (s64 k = 0; k < (s64)kernel.size(); k++) {
+          const tT weight = kernel[k];
+          const eT* SENSE_RESTRICT tap = column + y0 + k - radius;
+          for (u32 i = 0; i < n; i++)
+            block[i] += weight * (tT)tap[i];
+        }
+        std::copy(block, block + n, out + y0);
+      }
+    }
+  });
+}
+
+template<typename eT>
+template<typename oT>
+void Filter<eT>::filterRows(oT* out, const uword outStride, const vector<tT>& kernel, const BorderMode border) {
+  const u32 height = scratch.n_rows;
+  const u32 width = scratch.n_cols;
+  const s64 radius = (s64)kernel.size() / 2;
+  const tT* const scratchMem = scratch.memptr();
+
+  parallelFor(width, minTileLines(height), [&](const uword begin, const uword end) {
+    tT block[FILTER_BLOCK_ROWS];
+    for (uword x = begin; x < end; x++) {
+      oT* SENSE_RESTRICT column = out + x * outStride;
+      for (u32 y0 = 0; y0 < height; y0 += FILTER_BLOCK_ROWS) {
+        const u32 n = std::min(FILTER_BLOCK_ROWS, height - y0);
+        std::fill(block, block + n, (tT)0);
+        for (s64 k = 0; k < (s64)kernel.size(); k++) {
+          const s64 source = borderIndex((s64)x + k - radius, width, border);
+          if (source < 0)
+            continue;
+          const tT weight = kernel[k];
+          const tT* SENSE_RESTRICT tap = scratchMem + source * height + y0;
+          for (u32 i = 0; i < n; i++)
+            block[i] += weight * tap[i];
+        }
+        for (u32 i = 0; i < n; i++)
+          column[y0 + i] = saturateCast<oT>(block[i]);
+      }
+    }
+  });
+}
+
+// Gradients of integer planes are float planes, which cannot overlap them.
+template<typename eT>
+bool gradientOverlaps(const MatRoi<eT>& roiIn, const Mat<eT>& gradientOut) {
+  return roiIn.overlaps(gradientOut);
+}
+
+template<typename eT, typename gT>
+bool gradientOverlaps(const MatRoi<eT>&, const Mat<gT>&) {
+  return false;
+}
+
+template<typename eT>
+void filterPlane(Filter<eT>& filter, Mat<eT>& matOut, const MatRoi<eT>& roiIn,
+                 const vector<typename Filter<eT>::tT>& yKernel, const vector<typename Filter<eT>::tT>& xKernel,
+                 const BorderMode border) {
+  // The input is read in full before the output is resized, so the output
+  // may be the matrix the region refers to.
+  filter.filterColumns(roiIn.mem, roiIn.stride, roiIn.height, roiIn.width, yKernel, border);
+  matOut.set_size(roiIn.height, roiIn.width);
+  filter.filterRows(matOut.memptr(), matOut.n_rows, xKernel, border);
+}
+
+template<typename eT>
+void filterImage(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+                 const vector<double>& yKernel, const vector<double>& xKernel, const BorderMode border) {
+  typedef typename Filter<eT>::tT tT;
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  const vector<tT> yWeights = filterKernel<tT>(yKernel);
+  const vector<tT> xWeights = filterKernel<tT>(xKernel);
+  // The three planes share the same scratch plane.
+  Filter<eT> filter;
+  filterPlane(filter, imageOut.r, MatRoi<eT>(imageIn.r), yWeights, xWeights, border);
+  filterPlane(filter, imageOut.g, MatRoi<eT>(imageIn.g), yWeights, xWeights, border);
+  filterPlane(filter, imageOut.b, MatRoi<eT>(imageIn.b), yWeights, xWeights, border);
+  imageOut.height = imageIn.height;
+  imageOut.width = imageIn.width;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to filter images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void filter(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<double>& yKernel, const vector<double>& xKernel,
+            const BorderMode border /* default: BORDER_REFLECT */) {
+  filter(matOut, MatRoi<eT>(matIn), yKernel, xKernel, border);
+}
+
+template<typename eT>
+void filter(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const vector<double>& yKernel, const vector<double>& xKernel,
+            const BorderMode border /* default: BORDER_REFLECT */) {
+  typedef typename Filter<eT>::tT tT;
+  Filter<eT> filter;
+  filterPlane(filter, matOut, roiIn, filterKernel<tT>(yKernel), filterKernel<tT>(xKernel), border);
+}
+
+template<typename eT>
+void filter(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+            const vector<double>& yKernel, const vector<double>& xKernel,
+            const BorderMode border /* default: BORDER_REFLECT */) {
+  filterImage(imageOut, imageIn, yKernel, xKernel, border);
+}
+
+template<typename eT>
+void gaussianBlur(Mat<eT>& matOut, const Mat<eT>& matIn, const double sigma,
+                  const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gaussianBlur(filter, matOut, MatRoi<eT>(matIn), sigma, border);
+}
+
+template<typename eT>
+void gaussianBlur(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const double sigma,
+                  const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gaussianBlur(filter, matOut, roiIn, sigma, border);
+}
+
+template<typename eT>
+void gaussianBlur(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn, const double sigma,
+                  const BorderMode border /* default: BORDER_REFLECT */) {
+  const vector<double> kernel = gaussianKernel(sigma);
+  filterImage(imageOut, imageIn, kernel, kernel, border);
+}
+
+template<typename eT>
+void boxBlur(Mat<eT>& matOut, const Mat<eT>& matIn, const u32 radius,
+             const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  boxBlur(filter, matOut, MatRoi<eT>(matIn), radius, border);
+}
+
+template<typename eT>
+void boxBlur(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const u32 radius,
+             const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  boxBlur(filter, matOut, roiIn, radius, border);
+}
+
+template<typename eT>
+void boxBlur(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn, const u32 radius,
+             const BorderMode border /* default: BORDER_REFLECT */) {
+  const vector<double> kernel = boxKernel(radius);
+  filterImage(imageOut, imageIn, kernel, kernel, border);
+}
+
+template<typename eT>
+void gradient(Mat<typename GradientType<eT>::type>& dxOut, Mat<typename GradientType<eT>::type>& dyOut,
+              const Mat<eT>& matIn, const GradientOperator op /* default: GRADIENT_SOBEL */,
+              const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gradient(filter, dxOut, dyOut, MatRoi<eT>(matIn), op, border);
+}
+
+template<typename eT>
+void gradient(Mat<typename GradientType<eT>::type>& dxOut, Mat<typename GradientType<eT>::type>& dyOut,
+              const MatRoi<eT>& roiIn, const GradientOperator op /* default: GRADIENT_SOBEL */,
+              const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gradient(filter, dxOut, dyOut, roiIn, op, border);
+}
+
+template<typename eT>
+void gradientMagnitude(Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut,
+                       const Mat<eT>& matIn, const GradientOperator op /* default: GRADIENT_SOBEL */,
+                       const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gradientMagnitude(filter, magnitudeOut, orientationOut, MatRoi<eT>(matIn), op, border);
+}
+
+template<typename eT>
+void gradientMagnitude(Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut,
+                       const MatRoi<eT>& roiIn, const GradientOperator op /* default: GRADIENT_SOBEL */,
+                       const BorderMode border /* default: BORDER_REFLECT */) {
+  Filter<eT> filter;
+  gradientMagnitude(filter, magnitudeOut, orientationOut, roiIn, op, border);
+}
+
+template<typename eT>
+void gaussianBlur(Filter<eT>& filter, Mat<eT>& matOut, const MatRoi<eT>& roiIn, const double sigma,
+                  const BorderMode border /* default: BORDER_REFLECT */) {
+  typedef typename Filter<eT>::tT tT;
+  const vector<tT> kernel = filterKernel<tT>(gaussianKernel(sigma));
+  filterPlane(filter, matOut, roiIn, kernel, kernel, border);
+}
+
+template<typename eT>
+void boxBlur(Filter<eT>& filter, Mat<eT>& matOut, const MatRoi<eT>& roiIn, const u32 radius,
+             const BorderMode border /* default: BORDER_REFLECT */) {
+  typedef typename Filter<eT>::tT tT;
+  const vector<tT> kernel = filterKernel<tT>(boxKernel(radius));
+  filterPlane(filter, matOut, roiIn, kernel, kernel, border);
+}
+
+template<typename eT>
+void gradient(Filter<eT>& filter, Mat<typename GradientType<eT>::type>& dxOut,
+              Mat<typename GradientType<eT>::type>& dyOut, const MatRoi<eT>& roiIn,
+              const GradientOperator op /* default: GRADIENT_SOBEL */,
+              const BorderMode border /* default: BORDER_REFLECT */) {
+  typedef typename Filter<eT>::tT tT;
+  if (gradientOverlaps(roiIn, dxOut) || gradientOverlaps(roiIn, dyOut))
+    throw logic_error("Gradients cannot be written over their input");
+  const vector<tT> smoothing = filterKernel<tT>(smoothingKernel(op));
+  const vector<tT> derivative = filterKernel<tT>(derivativeKernel());
+
+  filter.filterColumns(roiIn.mem, roiIn.stride, roiIn.height, roiIn.width, smoothing, border);
+  dxOut.set_size(roiIn.height, roiIn.width);
+  filter.filterRows(dxOut.memptr(), dxOut.n_rows, derivative, border);
+
+  filter.filterColumns(roiIn.mem, roiIn.stride, roiIn.height, roiIn.width, derivative, border);
+  dyOut.set_size(roiIn.height, roiIn.width);
+  filter.filterRows(dyOut.memptr(), dyOut.n_rows, smoothing, border);
+}
+
+template<typename eT>
+void gradientMagnitude(Filter<eT>& filter, Mat<typename GradientType<eT>::type>& magnitudeOut,
+                       Mat<typename GradientType<eT>::type>& orientationOut, const MatRoi<eT>& roiIn,
+                       const GradientOperator op /* default: GRADIENT_SOBEL */,
+                       const BorderMode border /* default: BORDER_REFLECT */) {
+  typedef typename GradientType<eT>::type gT;
+  // The gradients are computed into the outputs and replaced pixel by pixel.
+  gradient(filter, magnitudeOut, orientationOut, roiIn, op, border);
+  gT* magnitude = magnitudeOut.memptr();
+  gT* orientation = orientationOut.memptr();
+  parallelFor(magnitudeOut.n_elem, minTilePixels(), [&](const uword begin, const uword end) {
+    for (uword i = begin; i < end; i++) {
+      const gT dx = magnitude[i];
+      const gT dy = orientation[i];
+      magnitude[i] = sqrt(dx * dx + dy * dy);
+      orientation[i] = atan2(dy, dx);
+    }
+  });
+}
+
+}  /* namespace sense */
+
+#endif  /* __FILTER_IMPL_H__ */
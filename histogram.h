@@ -0,0 +1,113 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <armadillo>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Color histogram classes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Bins of one channel: bins bins of equal width covering min - max. Values
+// below min or above max are counted in the first or last bin.
+
+struct HistogramChannel {
+  u32 bins;
+  double min;
+  double max;
+  HistogramChannel() : bins(1), min(0), max(1) {}
+  HistogramChannel(const u32 bins, const double min, const double max) : bins(bins), min(min), max(max) {}
+};
+
+// Range of channel 0, 1 or 2 of a color space for images with elements of
+// type eT (see ColorSpace), split into bins bins. Integer images cover
+// 0 - 256, so that 256 bins hold one value each.
+
+template<typename eT>
+HistogramChannel histogramChannel(const ColorSpace colorSpace, const u32 channel, const u32 bins);
+
+enum HistogramKind {
+  HISTOGRAM_JOINT = 0,  // One count per combination of bins of the three channels
+  HISTOGRAM_MARGINAL = 1  // The counts of channel 0, then channel 1, then channel 2
+};
+
+// Histogram of the three channels of a color space. counts holds, for
+// HISTOGRAM_JOINT, channels[0].bins * channels[1].bins * channels[2].bins
+// counts indexed by index(bin0, bin1, bin2), and for HISTOGRAM_MARGINAL,
+// channels[0].bins + channels[1].bins + channels[2].bins counts indexed by
+// index(channel, bin).
+
+class ColorHistogram {
+  public:
+    ColorSpace colorSpace;
+    HistogramKind kind;
+    HistogramChannel channels[3];
+    Col<uword> counts;
+    ColorHistogram();
+    ColorHistogram(const ColorSpace colorSpace, const HistogramKind kind,
+                   const HistogramChannel& channel0, const HistogramChannel& channel1,
+                   const HistogramChannel& channel2);
+    uword size() const;
+    uword index(const u32 bin0, const u32 bin1, const u32 bin2) const {
+      return bin0 + channels[0].bins * (bin1 + (uword)channels[1].bins * bin2);
+    }
+    uword index(const u32 channel, const u32 bin) const {
+      return ((channel > 0) ? channels[0].bins : 0) + ((channel > 1) ? channels[1].bins : 0) + bin;
+    }
+    bool check() const;
+    void print(ostream& stream) const;
+};
+
+// Histogram of a color space with the ranges of histogramChannel().
+
+template<typename eT>
+ColorHistogram colorHistogram(const ColorSpace colorSpace, const HistogramKind kind,
+                              const u32 bins0, const u32 bins1, const u32 bins2);
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to compute color histograms.
+////////////////////////////////////////////////////////////////////////////////
+
+// Count the pixels of an image, of any color space, into the color space of
+// histogramOut, replacing its counts. Images in another color space are
+// converted on the fly, a block of pixels at a time with the same kernels as
+// convert(), so that no converted image is ever stored and the planes are
+// read once. Threads count into histograms of their own, which are added up
+// at the end.
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const Image<eT>& image,
+               const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const ImageRGBRoi<eT>& roi,
+               const ConversionMode mode = CONVERSION_DEFAULT);
+
+// The same for the pixels whose mask value is not 0. The mask has the size
+// of the image (e.g. the output of threshold()).
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const Image<eT>& image, const Mat<eT>& mask,
+               const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const ImageRGBRoi<eT>& roi, const MatRoi<eT>& mask,
+               const ConversionMode mode = CONVERSION_DEFAULT);
+
+////////////////////////////////////////////////////////////////////////////////
+// Overloaded operators.
+////////////////////////////////////////////////////////////////////////////////
+
+ostream& operator<<(ostream& stream, const ColorHistogram& histogram);
+
+}  /* namespace sense */
+
+#include "histogram_impl.h"
+
+#endif  /* __HISTOGRAM_H__ */
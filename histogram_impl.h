@@ -0,0 +1,265 @@
+#ifndef __HISTOGRAM_IMPL_H__
+#define __HISTOGRAM_IMPL_H__
+
+#include <mutex>
+#include <vector>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Number of pixels converted at a time into the scratch planes of a thread.
+const uword HISTOGRAM_BLOCK_PIXELS = 256;
+
+// Bin of the values of a channel.
+class ChannelBinner {
+  public:
+    explicit ChannelBinner(const HistogramChannel& channel)
+      : min(channel.min), scale(channel.bins / (channel.max - channel.min)), last(channel.bins - 1) {}
+
+    // NaN (e.g. normalized R'G'B' of black) goes to the first bin.
+    SENSE_FORCE_INLINE u32 operator()(const double value) const {
+      const double x = (value - min) * scale;
+      return (x > 0) ? ((x < last) ? (u32)x : last) : 0;
+    }
+
+  private:
+    double min;
+    double scale;
+    u32 last;
+};
+
+// Count n pixels, given as three planes of the color space of the
+// histogram, into counts. mask may be NULL.
+template<typename eT>
+void countPixels(uword* counts, const ColorHistogram& histogram, const ChannelBinner* binners,
+                 const eT* in0, const eT* in1, const eT* in2, const eT* mask, const uword n) {
+  if (histogram.kind == HISTOGRAM_JOINT) {
+    const uword stride1 = histogram.channels[0].bins;
+    const uword stride2 = stride1 * histogram.channels[1].bins;
+    for (uword i = 0; i < n; i++) {
+      if (mask != NULL && mask[i] == 0)
+        continue;
+      counts[binners[0](in0[i]) + stride1 * binners[1](in1[i]) + stride2 * binners[2](in2[i])]++;
+    }
+  }
+  else {
+    uword* counts1 = counts + histogram.index(1, 0);
+    uword* counts2 = counts + histogram.index(2, 0);
+    for (uword i = 0; i < n; i++) {
+      if (mask != NULL && mask[i] == 0)
+        continue;
+      counts[binners[0](in0[i])]++;
+      counts1[binners[1](in1[i])]++;
+      counts2[binners[2](in2[i])]++;
+    }
+  }
+}
+
+// Count the pixels of three planes of a color space, converting them with
+// kernel (NULL if they already are in the color space of the histogram).
+// mask may be NULL.
+template<typename eT>
+void countRegion(ColorHistogram& histogramOut, PixelKernel<eT> kernel,
+                 const MatRoi<eT>& in0, const MatRoi<eT>& in1, const MatRoi<eT>& in2, const MatRoi<eT>* mask) {
+  if (!histogramOut.check())
+    throw logic_error("Inconsistent bins in histogram");
+  histogramOut.counts.zeros();
+
+  const ChannelBinner binners[3] = {
+    ChannelBinner(histogramOut.channels[0]),
+    ChannelBinner(histogramOut.channels[1]),
+    ChannelBinner(histogramOut.channels[2])
+  };
+
+  // Count a run of consecutive pixels.
+  const auto countRun = [&](uword* counts, const eT* run0, const eT* run1, const eT* run2,
+                            const eT* runMask, const uword n) {
+    if (kernel == NULL) {
+      countPixels(counts, histogramOut, binners, run0, run1, run2, runMask, n);
+      return;
+    }
+    eT block0[HISTOGRAM_BLOCK_PIXELS];
+    eT block1[HISTOGRAM_BLOCK_PIXELS];
+    eT block2[HISTOGRAM_BLOCK_PIXELS];
+    for (uword begin = 0; begin < n; begin += HISTOGRAM_BLOCK_PIXELS) {
+      const uword count = std::min(HISTOGRAM_BLOCK_PIXELS, n - begin);
+      kernel(run0 + begin, run1 + begin, run2 + begin, block0, block1, block2, count);
+      countPixels(counts, histogramOut, binners, block0, block1, block2,
+                  (runMask != NULL) ? runMask + begin : NULL, count);
+    }
+  };
+
+  // Each band counts into a histogram of its own and adds it to the result.
+  mutex countsLock;
+  const auto addCounts = [&](const vector<uword>& bandCounts) {
+    lock_guard<mutex> guard(countsLock);
+    for (uword k = 0; k < bandCounts.size(); k++)
+      histogramOut.counts[k] += bandCounts[k];
+  };
+
+  const u32 height = in0.height;
+  const u32 width = in0.width;
+  if (in0.isContiguous() && in1.isContiguous() && in2.isContiguous() && (mask == NULL || mask->isContiguous())) {
+    parallelFor((uword)height * width, minTilePixels(), [&](const uword begin, const uword end) {
+      vector<uword> bandCounts(histogramOut.counts.n_elem, 0);
+      countRun(bandCounts.data(), in0.mem + begin, in1.mem + begin, in2.mem + begin,
+               (mask != NULL) ? mask->mem + begin : NULL, end - begin);
+      addCounts(bandCounts);
+    });
+    return;
+  }
+  parallelFor(width, minTileLines(height), [&](const uword begin, const uword end) {
+    vector<uword> bandCounts(histogramOut.counts.n_elem, 0);
+    for (uword x = begin; x < end; x++) {
+      countRun(bandCounts.data(), in0.colptr(x), in1.colptr(x), in2.colptr(x),
+               (mask != NULL) ? mask->colptr(x) : NULL, height);
+    }
+    addCounts(bandCounts);
+  });
+}
+
+template<typename eT>
+PixelKernel<eT> histogramKernel(const ColorHistogram& histogram, const ColorSpace colorSpaceIn,
+                                const ConversionMode mode) {
+  if (histogram.colorSpace == colorSpaceIn)
+    return NULL;
+  return conversionKernel<eT>(histogram.colorSpace, colorSpaceIn, mode);
+}
+
+template<typename eT>
+void countImage(ColorHistogram& histogramOut, const Image<eT>& image, const MatRoi<eT>* mask,
+                const ConversionMode mode) {
+  if (!image.check())
+    throw logic_error("Inconsistent height and width in image");
+  const Mat<eT>* planes[3];
+  imagePlanes(image, planes[0], planes[1], planes[2]);
+  countRegion(histogramOut, histogramKernel<eT>(histogramOut, image.colorSpace(), mode),
+              MatRoi<eT>(*planes[0]), MatRoi<eT>(*planes[1]), MatRoi<eT>(*planes[2]), mask);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ColorHistogram implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+HistogramChannel histogramChannel(const ColorSpace colorSpace, const u32 channel, const u32 bins) {
+  // Ranges of the channels of floating-point images.
+  static const double ranges[6][3][2] = {
+    {{0, 255}, {0, 255}, {0, 255}},  // RGB
+    {{0, 255}, {0, 255}, {0, 255}},  // Normalized R'G'B'
+    {{0, 95.047}, {0, 100}, {0, 108.883}},  // XYZ
+    {{0, 100}, {-128, 128}, {-128, 128}},  // L*a*b*
+    {{0, 1}, {0, 1}, {0, 1}},  // HSV
+    {{0, 1}, {-0.5, 0.5}, {-0.5, 0.5}}  // Y'CbCr
+  };
+  if (colorSpace < COLORSPACE_RGB || colorSpace > COLORSPACE_YCBCR)
+    throw logic_error("Unknown color space");
+  if (channel > 2)
+    throw logic_error("Color spaces have channels 0 - 2");
+  if (is_integral<eT>::value)
+    return HistogramChannel(bins, 0, 256);
+  return HistogramChannel(bins, ranges[colorSpace][channel][0], ranges[colorSpace][channel][1]);
+}
+
+inline ColorHistogram::ColorHistogram()
+  : colorSpace(COLORSPACE_RGB), kind(HISTOGRAM_JOINT) {
+  counts.set_size(size());
+  counts.zeros();
+}
+
+inline ColorHistogram::ColorHistogram(const ColorSpace colorSpace, const HistogramKind kind,
+                                      const HistogramChannel& channel0, const HistogramChannel& channel1,
+                                      const HistogramChannel& channel2)
+  : colorSpace(colorSpace), kind(kind) {
+  channels[0] = channel0;
+  channels[1] = channel1;
+  channels[2] = channel2;
+  for (u32 i = 0; i < 3; i++) {
+    if (channels[i].bins == 0 || !(channels[i].max > channels[i].min))
+      throw logic_error("Channels need at least one bin and a range");
+  }
+  counts.set_size(size());
+  counts.zeros();
+}
+
+inline uword ColorHistogram::size() const {
+  if (kind == HISTOGRAM_JOINT)
+    return (uword)channels[0].bins * channels[1].bins * channels[2].bins;
+  return (uword)channels[0].bins + channels[1].bins + channels[2].bins;
+}
+
+inline bool ColorHistogram::check() const {
+  for (u32 i = 0; i < 3; i++) {
+    if (channels[i].bins == 0 || !(channels[i].max > channels[i].min))
+      return false;
+  }
+  return (counts.n_elem == size());
+}
+
+inline void ColorHistogram::print(ostream& stream) const {
+  stream << "Color space: " << colorSpace << endl;
+  stream << "Kind       : " << ((kind == HISTOGRAM_JOINT) ? "joint" : "marginal") << endl;
+  for (u32 i = 0; i < 3; i++) {
+    stream << "Channel " << i << "  : " << channels[i].bins << " bins, "
+           << channels[i].min << " - " << channels[i].max << endl;
+  }
+  stream << "Counts: " << endl << counts << endl;
+}
+
+template<typename eT>
+ColorHistogram colorHistogram(const ColorSpace colorSpace, const HistogramKind kind,
+                              const u32 bins0, const u32 bins1, const u32 bins2) {
+  return ColorHistogram(colorSpace, kind,
+                        histogramChannel<eT>(colorSpace, 0, bins0),
+                        histogramChannel<eT>(colorSpace, 1, bins1),
+                        histogramChannel<eT>(colorSpace, 2, bins2));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to compute color histograms.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const Image<eT>& image,
+               const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  countImage<eT>(histogramOut, image, NULL, mode);
+}
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const ImageRGBRoi<eT>& roi,
+               const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  countRegion<eT>(histogramOut, histogramKernel<eT>(histogramOut, COLORSPACE_RGB, mode), roi.r, roi.g, roi.b, NULL);
+}
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const Image<eT>& image, const Mat<eT>& mask,
+               const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!checkSize(mask, image.height, image.width))
+    throw logic_error("Mask and image differ in size");
+  const MatRoi<eT> maskRoi(mask);
+  countImage(histogramOut, image, &maskRoi, mode);
+}
+
+template<typename eT>
+void histogram(ColorHistogram& histogramOut, const ImageRGBRoi<eT>& roi, const MatRoi<eT>& mask,
+               const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (mask.height != roi.height || mask.width != roi.width)
+    throw logic_error("Mask and region differ in size");
+  countRegion(histogramOut, histogramKernel<eT>(histogramOut, COLORSPACE_RGB, mode), roi.r, roi.g, roi.b, &mask);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Overloaded operators.
+////////////////////////////////////////////////////////////////////////////////
+
+inline ostream& operator<<(ostream& stream, const ColorHistogram& histogram) {
+  histogram.print(stream);
+  return stream;
+}
+
+}  /* namespace sense */
+
+#endif  /* __HISTOGRAM_IMPL_H__ */
@@ -2,6 +2,13 @@
 #define __IMAGE_H__
 
 #include <armadillo>
+#include <functional>
+#include <vector>
+#include <type_traits>
+
+#include "resample.h"
+#include "simd.h"
+#include "parallel.h"
 
 using namespace std;
 using namespace arma;
@@ -21,15 +28,41 @@ enum ColorSpace {
   COLORSPACE_YCBCR = 5  // Y'CbCr
 };
 
+// Images with floating-point elements hold R, G, B in 0 - 255 and the other
+// color spaces in their usual ranges (e.g. H, S, V in 0 - 1, L* in 0 - 100).
+// Images with integer elements (u8, u16) hold every channel in 0 - 255 and
+// are converted in fixed point, with tables for the sRGB gamma curve and the
+// L*a*b* cube root and without floating-point math per pixel:
+//   Normalized R'G'B'  as for floating point
+//   XYZ                X / 95.047, Y / 100 and Z / 108.883, times 255
+//   L*a*b*             L* times 2.55; a* and b* plus 128
+//   HSV                H, S and V times 255
+//   Y'CbCr             Full-range BT.601: Y' times 255; Cb and Cr times 255
+//                      plus 128
+// Results are rounded, and saturated where a channel can leave 0 - 255.
+
 ////////////////////////////////////////////////////////////////////////////////
 // Image classes.
 ////////////////////////////////////////////////////////////////////////////////
 
-// Abstract base image in some color space.
+// Color spaces as types. Each image class below names its color space as
+// Space, so that functions taking the image classes themselves (rather than
+// Image<eT>) resolve the conversion at compile time.
+
+struct RGBSpace;
+struct NormalizedRGBSpace;
+struct XYZSpace;
+struct LABSpace;
+struct HSVSpace;
+struct YCbCrSpace;
+
+// Abstract base image in some color space. Its virtual functions serve
+// callers that only know the color space at run time.
 
 template<typename eT>
 class Image {
   public:
+    typedef eT elem_type;
     u32 height;
     u32 width;
     virtual ColorSpace colorSpace() const = 0;
@@ -43,6 +76,7 @@ class Image {
 template<typename eT>
 class ImageRGB: public Image<eT> {
   public:
+    typedef RGBSpace Space;
     Mat<eT> r;
     Mat<eT> g;
     Mat<eT> b;
@@ -60,6 +94,7 @@ class ImageRGB: public Image<eT> {
 template<typename eT>
 class ImageNormalizedRGB: public Image<eT> {
   public:
+    typedef NormalizedRGBSpace Space;
     Mat<eT> normalizedR;
     Mat<eT> normalizedG;
     Mat<eT> normalizedB;
@@ -77,6 +112,7 @@ class ImageNormalizedRGB: public Image<eT> {
 template<typename eT>
 class ImageXYZ: public Image<eT> {
   public:
+    typedef XYZSpace Space;
     Mat<eT> x;
     Mat<eT> y;
     Mat<eT> z;
@@ -94,6 +130,7 @@ class ImageXYZ: public Image<eT> {
 template<typename eT>
 class ImageLAB: public Image<eT> {
   public:
+    typedef LABSpace Space;
     Mat<eT> l;
     Mat<eT> a;
     Mat<eT> b;
@@ -111,6 +148,7 @@ class ImageLAB: public Image<eT> {
 template<typename eT>
 class ImageHSV: public Image<eT> {
   public:
+    typedef HSVSpace Space;
     Mat<eT> h;
     Mat<eT> s;
     Mat<eT> v;
@@ -128,6 +166,7 @@ class ImageHSV: public Image<eT> {
 template<typename eT>
 class ImageYCbCr: public Image<eT> {
   public:
+    typedef YCbCrSpace Space;
     Mat<eT> y;
     Mat<eT> cb;
     Mat<eT> cr;
@@ -140,6 +179,132 @@ class ImageYCbCr: public Image<eT> {
     void print(ostream& stream) const;
 };
 
+// Whether T is one of the image classes above, as opposed to Image<eT>.
+
+template<class T, class = void>
+struct IsColorImage: false_type {};
+
+template<class T>
+struct IsColorImage<T, typename conditional<true, void, typename T::Space>::type>: true_type {};
+
+// Pixel formats of packed images. The value is the number of channels.
+
+enum PixelFormat {
+  PIXELFORMAT_RGB8 = 3,  // R, G, B bytes
+  PIXELFORMAT_RGBA8 = 4  // R, G, B, A bytes
+};
+
+// 8-bit image with interleaved channels, stored row by row. This is the layout
+// decoders produce, and it takes 3 (or 4) bytes per pixel instead of the
+// 3 * sizeof(eT) bytes of the planar classes above. load, save and resize
+// work on it directly, so decoding and displaying an image never widens it.
+
+class ImagePacked {
+  public:
+    typedef u8 elem_type;
+    u32 height;
+    u32 width;
+    PixelFormat format;
+    Col<u8> data;
+    ImagePacked() { setSize(0, 0, PIXELFORMAT_RGB8); }
+    ImagePacked(const u32 height, const u32 width, const PixelFormat format = PIXELFORMAT_RGB8) {
+      setSize(height, width, format);
+    }
+    u32 channels() const { return format; }
+    uword rowStride() const { return (uword)width * channels(); }
+    u8* row(const u32 y) { return data.memptr() + y * rowStride(); }
+    const u8* row(const u32 y) const { return data.memptr() + y * rowStride(); }
+    void setSize(const u32 newHeight, const u32 newWidth);
+    void setSize(const u32 newHeight, const u32 newWidth, const PixelFormat newFormat);
+    bool check() const;
+    void print(ostream& stream) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Region of interest (ROI) classes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Read-only view of a rectangular region of a Mat<eT>. The view refers to the
+// memory of the matrix it was taken from, so creating it neither allocates
+// nor copies, and it must not outlive (or be used across a resize of) that
+// matrix. Pixels are copied only by copyTo().
+
+template<typename eT>
+class MatRoi {
+  public:
+    const eT* mem;  // Element (0, 0) of the region
+    uword stride;   // Distance between the starts of two adjacent columns
+    u32 height;
+    u32 width;
+    MatRoi(const Mat<eT>& mat);
+    MatRoi(const Mat<eT>& mat, const u32 yOffset, const u32 xOffset, const u32 height, const u32 width);
+    MatRoi(const eT* mem, const uword stride, const u32 height, const u32 width);
+    const eT* colptr(const u32 x) const { return mem + x * stride; }
+    eT operator()(const u32 y, const u32 x) const { return mem[x * stride + y]; }
+    bool isContiguous() const { return (stride == height || width <= 1); }
+    bool overlaps(const Mat<eT>& mat) const;
+    void copyTo(Mat<eT>& matOut) const;
+};
+
+// Read-only view of a rectangular region of an ImageRGB<eT>, with the same
+// lifetime rules as MatRoi.
+
+template<typename eT>
+class ImageRGBRoi {
+  public:
+    u32 height;
+    u32 width;
+    MatRoi<eT> r;
+    MatRoi<eT> g;
+    MatRoi<eT> b;
+    ImageRGBRoi(const ImageRGB<eT>& image);
+    ImageRGBRoi(const ImageRGB<eT>& image,
+                const u32 yOffset, const u32 xOffset, const u32 height, const u32 width);
+    ImageRGBRoi(const MatRoi<eT>& r, const MatRoi<eT>& g, const MatRoi<eT>& b);
+    ColorSpace colorSpace() const { return COLORSPACE_RGB; }
+    bool isContiguous() const { return (r.isContiguous() && g.isContiguous() && b.isContiguous()); }
+    void copyTo(ImageRGB<eT>& imageOut) const;
+};
+
+// Create views. Regions that do not fit inside the source throw logic_error.
+
+template<typename eT>
+MatRoi<eT> roi(const Mat<eT>& mat,
+               const u32 yOffset, const u32 xOffset, const u32 height, const u32 width);
+
+template<typename eT>
+ImageRGBRoi<eT> roi(const ImageRGB<eT>& image,
+                    const u32 yOffset, const u32 xOffset, const u32 height, const u32 width);
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion mode.
+////////////////////////////////////////////////////////////////////////////////
+
+// How the conversions between RGB and XYZ or L*a*b* evaluate the sRGB gamma
+// curve and the L*a*b* cube root.
+//
+// CONVERSION_FAST linearizes sRGB with a table (exact at the 256 integer
+// values, linearly interpolated between them), encodes sRGB by searching a
+// table of rounding thresholds, and computes cube roots with a bit-level
+// estimate refined by two Halley iterations. Compared with CONVERSION_EXACT:
+// XYZ values differ by at most 2e-5 and L*a*b* values by at most 1e-3. RGB
+// results of the inverse conversions are identical, except for values that
+// fall within about 1e-9 of a rounding boundary. Inputs outside the nominal
+// range (e.g. RGB below 0 or above 255) use the exact formulas. Images
+// with integer elements ignore the mode.
+
+enum ConversionMode {
+  CONVERSION_DEFAULT = 0,  // Use the mode set by setConversionMode()
+  CONVERSION_EXACT = 1,  // pow() for every pixel (initial global mode)
+  CONVERSION_FAST = 2  // Lookup tables and approximations
+};
+
+// Set and get the global mode used by calls that pass CONVERSION_DEFAULT.
+
+void setConversionMode(const ConversionMode mode);
+
+ConversionMode conversionMode();
+
 ////////////////////////////////////////////////////////////////////////////////
 // Overloaded operators.
 ////////////////////////////////////////////////////////////////////////////////
@@ -159,12 +324,23 @@ bool load(ImageRGB<eT>& image, const string& path);
 template<typename eT>
 bool load(Image<eT>& image, const string& path);
 
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value, bool>::type
+load(ImageT& image, const string& path);
+
 template<typename eT>
-bool save(ImageRGB<eT>& image, const string& path);
+bool save(const ImageRGB<eT>& image, const string& path);
 
 template<typename eT>
 bool save(const Image<eT>& image, const string& path);
 
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value, bool>::type
+save(const ImageT& image, const string& path);
+
+template<typename eT>
+bool save(const ImageRGBRoi<eT>& roi, const string& path);
+
 // Load and save grayscale images in the form of Mat<eT> objects.
 
 template<typename eT>
@@ -173,6 +349,70 @@ bool load(Mat<eT>& mat, const string& path);
 template<typename eT>
 bool save(const Mat<eT>& mat, const string& path);
 
+template<typename eT>
+bool save(const MatRoi<eT>& roi, const string& path);
+
+// Load and save color images in the form of ImagePacked objects. load keeps
+// the pixel format the image already has.
+
+bool load(ImagePacked& image, const string& path);
+
+bool save(const ImagePacked& image, const string& path);
+
+// Load a color image strip by strip, without ever holding the whole image.
+// The image is decoded row by row into strip, stripRows rows at a time (fewer
+// for the last strip), and process(y) is called each time the strip is full,
+// y being the image row of the first row of the strip. Run the conversion,
+// grayscale and threshold steps on the strip inside process, so that memory
+// use depends on the strip size rather than the image size.
+//
+// Returns false if the image cannot be decoded or if process returns false,
+// which stops decoding. Exceptions thrown by process are rethrown. Rows are
+// taken in the order the decoder produces them, as by the ImageMagick stream
+// API this relies on, which is top to bottom for JPEG, PNG, PNM and
+// strip-organized TIFF; images decoded in tiles are rejected.
+
+template<typename eT>
+bool loadStrips(ImageRGB<eT>& strip, const string& path, const u32 stripRows,
+                const function<bool(const u32 y)>& process);
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to load images at reduced size.
+////////////////////////////////////////////////////////////////////////////////
+
+// Load an image resized to height x width, as load() followed by resize() but
+// without decoding pixels only to throw them away: decoders that can scale
+// while decoding (JPEG, by 1/2, 1/4 or 1/8 in the DCT domain) decode straight
+// to the smallest of those sizes that is at least height x width, and the
+// result is resized to height x width with filter. Other formats are decoded
+// at full size and resized.
+
+template<typename eT>
+bool load(ImageRGB<eT>& image, const string& path,
+          const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+template<typename eT>
+bool load(Mat<eT>& mat, const string& path,
+          const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+bool load(ImagePacked& image, const string& path,
+          const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+// The same with the size given as a fraction of the size of the image (e.g.
+// 0.25 for a quarter of its height and width), rounded and at least 1 x 1.
+// scale must be greater than 0.
+
+template<typename eT>
+bool load(ImageRGB<eT>& image, const string& path,
+          const double scale, const ResizeFilter filter = RESIZE_LANCZOS);
+
+template<typename eT>
+bool load(Mat<eT>& mat, const string& path,
+          const double scale, const ResizeFilter filter = RESIZE_LANCZOS);
+
+bool load(ImagePacked& image, const string& path,
+          const double scale, const ResizeFilter filter = RESIZE_LANCZOS);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Functions to resize images.
 ////////////////////////////////////////////////////////////////////////////////
@@ -181,19 +421,36 @@ bool save(const Mat<eT>& mat, const string& path);
 
 template<typename eT>
 bool resize(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
-            const u32 height, const u32 width);
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
 
 // Resize grayscale images in the form of Mat<eT> objects.
 
 template<typename eT>
 bool resize(Mat<eT>& matOut, const Mat<eT>& matIn,
-            const u32 height, const u32 width);
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+// Resize with the given resizer, which keeps its filter weights and scratch
+// plane for further images of the same sizes.
+
+template<typename eT>
+bool resize(Resizer<eT>& resizer, ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+template<typename eT>
+bool resize(Resizer<eT>& resizer, Mat<eT>& matOut, const Mat<eT>& matIn,
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
+
+// Resize color images in the form of ImagePacked objects.
+
+bool resize(ImagePacked& imageOut, const ImagePacked& imageIn,
+            const u32 height, const u32 width, const ResizeFilter filter = RESIZE_LANCZOS);
 
 ////////////////////////////////////////////////////////////////////////////////
 // Functions to crop images.
 ////////////////////////////////////////////////////////////////////////////////
 
-// Crop color images in the form of ImageRGB<eT> objects.
+// Crop color images in the form of ImageRGB<eT> objects. Cropping copies the
+// pixels; use roi() to refer to a region without copying.
 
 template<typename eT>
 bool crop(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
@@ -209,12 +466,81 @@ bool crop(Mat<eT>& matOut, const Mat<eT>& matIn,
 // Functions to threshold images.
 ////////////////////////////////////////////////////////////////////////////////
 
-// Threshold images in the form of Mat<eT> objects.
+// Threshold images in the form of Mat<eT> objects. Pixels above cutoff are
+// set to aboveCutoffValue, the others to belowCutoffValue.
 
 template<typename eT>
 bool threshold(Mat<eT>& matOut, const Mat<eT>& matIn,
                const eT cutoff, const eT belowCutoffValue = 0, const eT aboveCutoffValue = 255);
 
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const MatRoi<eT>& roiIn,
+               const eT cutoff, const eT belowCutoffValue = 0, const eT aboveCutoffValue = 255);
+
+// Threshold in place, without allocating.
+
+template<typename eT>
+bool threshold(Mat<eT>& mat, const eT cutoff, const eT belowCutoffValue = 0, const eT aboveCutoffValue = 255);
+
+// Threshold at several levels: pixels above k of the cutoffs, which must be
+// in increasing order, are set to values[k]. values has one more element
+// than cutoffs.
+
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<eT>& cutoffs, const vector<eT>& values);
+
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const vector<eT>& cutoffs, const vector<eT>& values);
+
+template<typename eT>
+bool threshold(Mat<eT>& mat, const vector<eT>& cutoffs, const vector<eT>& values);
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to choose thresholds.
+////////////////////////////////////////////////////////////////////////////////
+
+// Histogram of a grayscale image in one pass: counts[k] is the number of
+// pixels whose value rounds to k, for k in 0 - 255; values below 0 or above
+// 255 are counted in the first or last bin. Threads count into histograms of
+// their own, which are added up at the end.
+
+template<typename eT>
+void histogram(Col<uword>& counts, const Mat<eT>& mat);
+
+template<typename eT>
+void histogram(Col<uword>& counts, const MatRoi<eT>& roi);
+
+// Cutoffs of Otsu's method, which maximize the variance between the classes
+// of pixels they separate. otsuCutoff() returns the cutoff between two
+// classes, otsuCutoffs() the classes - 1 cutoffs, in increasing order,
+// between classes classes (multi-level Otsu, found exactly by dynamic
+// programming over the 256 bins in O(classes * 256^2)). classes must be in
+// 2 - 256.
+//
+// A cutoff separates the pixels that fall in histogram bins up to k from
+// those above. For integer elements it is k, for floating-point elements
+// k + 0.5, so that it can be passed to threshold() as is.
+
+u32 otsuCutoff(const Col<uword>& counts);
+
+vector<u32> otsuCutoffs(const Col<uword>& counts, const u32 classes);
+
+template<typename eT>
+eT otsuCutoff(const Mat<eT>& mat);
+
+template<typename eT>
+vector<eT> otsuCutoffs(const Mat<eT>& mat, const u32 classes);
+
+// Threshold at the cutoff of otsuCutoff(), or at the values.size() - 1
+// cutoffs of otsuCutoffs().
+
+template<typename eT>
+bool thresholdOtsu(Mat<eT>& matOut, const Mat<eT>& matIn,
+                   const eT belowCutoffValue = 0, const eT aboveCutoffValue = 255);
+
+template<typename eT>
+bool thresholdOtsu(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<eT>& values);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Functions to convert color space of Image objects.
 ////////////////////////////////////////////////////////////////////////////////
@@ -225,10 +551,12 @@ template<typename eT>
 void convert(ImageRGB<eT>& imageOut, const ImageNormalizedRGB<eT>& imageIn);
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageXYZ<eT>& imageIn);
+void convert(ImageRGB<eT>& imageOut, const ImageXYZ<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageLAB<eT>& imageIn);
+void convert(ImageRGB<eT>& imageOut, const ImageLAB<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
 
 template<typename eT>
 void convert(ImageRGB<eT>& imageOut, const ImageHSV<eT>& imageIn);
@@ -245,10 +573,12 @@ template<typename eT>
 void convert(ImageNormalizedRGB<eT>& imageOut, const ImageRGB<eT>& imageIn);
 
 template<typename eT>
-void convert(ImageXYZ<eT>& imageOut, const ImageRGB<eT>& imageIn);
+void convert(ImageXYZ<eT>& imageOut, const ImageRGB<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
 
 template<typename eT>
-void convert(ImageLAB<eT>& imageOut, const ImageRGB<eT>& imageIn);
+void convert(ImageLAB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
 
 template<typename eT>
 void convert(ImageHSV<eT>& imageOut, const ImageRGB<eT>& imageIn);
@@ -259,10 +589,47 @@ void convert(ImageYCbCr<eT>& imageOut, const ImageRGB<eT>& imageIn);
 template<typename eT>
 void convert(Image<eT>& imageOut, const ImageRGB<eT>& imageIn);
 
-// Convert any color space to any color space.
+// Convert a region of an RGB image to any color space.
+
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+template<typename eT>
+void convert(ImageNormalizedRGB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+template<typename eT>
+void convert(ImageXYZ<eT>& imageOut, const ImageRGBRoi<eT>& roiIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT>
+void convert(ImageLAB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT>
+void convert(ImageHSV<eT>& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+template<typename eT>
+void convert(ImageYCbCr<eT>& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+template<typename eT>
+void convert(Image<eT>& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+// Convert any color space to any color space. Every pair of color spaces is
+// converted directly in a single pass, without an intermediate image. XYZ and
+// L*a*b* are converted into each other without rounding to RGB on the way.
 
 template<typename eT>
-void convert(Image<eT>& imageOut, const Image<eT>& imageIn);
+void convert(Image<eT>& imageOut, const Image<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
+
+// The same for images whose classes are known at compile time. The kernel is
+// chosen by the compiler from the Space of both classes, without a call to
+// colorSpace(); Image<eT> arguments use the overload above.
+
+template<class ImageOut, class ImageIn>
+typename enable_if<IsColorImage<ImageOut>::value && IsColorImage<ImageIn>::value &&
+                   is_same<typename ImageOut::elem_type, typename ImageIn::elem_type>::value>::type
+convert(ImageOut& imageOut, const ImageIn& imageIn, const ConversionMode mode = CONVERSION_DEFAULT);
 
 // Convert grayscale to any color space.
 
@@ -270,7 +637,12 @@ template<typename eT>
 void convert(ImageRGB<eT>& imageOut, const Mat<eT>& matIn);
 
 template<typename eT>
-void convert(Image<eT>& imageOut, const Mat<eT>& matIn);
+void convert(Image<eT>& imageOut, const Mat<eT>& matIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<class ImageOut, typename eT>
+typename enable_if<IsColorImage<ImageOut>::value && is_same<typename ImageOut::elem_type, eT>::value>::type
+convert(ImageOut& imageOut, const Mat<eT>& matIn, const ConversionMode mode = CONVERSION_DEFAULT);
 
 // Convert any color space to grayscale.
 
@@ -278,7 +650,27 @@ template<typename eT>
 void convert(Mat<eT>& matOut, const ImageRGB<eT>& imageIn);
 
 template<typename eT>
-void convert(Mat<eT>& matOut, const Image<eT>& imageIn);
+void convert(Mat<eT>& matOut, const Image<eT>& imageIn,
+             const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT, class ImageIn>
+typename enable_if<IsColorImage<ImageIn>::value && is_same<typename ImageIn::elem_type, eT>::value>::type
+convert(Mat<eT>& matOut, const ImageIn& imageIn, const ConversionMode mode = CONVERSION_DEFAULT);
+
+template<typename eT>
+void convert(Mat<eT>& matOut, const ImageRGBRoi<eT>& roiIn);
+
+// Convert between packed and planar RGB. Planar values are rounded and
+// saturated to 0 - 255; the alpha channel, if any, is set to 255.
+
+template<typename eT>
+void convert(ImagePacked& imageOut, const ImageRGB<eT>& imageIn);
+
+template<typename eT>
+void convert(ImagePacked& imageOut, const ImageRGBRoi<eT>& roiIn);
+
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImagePacked& imageIn);
 
 }  /* namespace sense */
 
@@ -1,7 +1,12 @@
 #ifndef __IMAGE_IMPL_H__
 #define __IMAGE_IMPL_H__
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <exception>
+#include <new>
+#include <sstream>
 
 // NOTE: The following include must be outside the "sense" namespace.
 #include <Magick++.h>
@@ -17,73 +22,207 @@ bool checkSize(const Mat<eT>& mat, const u32 height, const u32 width) {
   return ((mat.n_rows == height) && (mat.n_cols == width));
 }
 
-// Convert Magick++ image to SENSE image.
+// Make mat a matrix over the given memory, which it neither copies nor frees.
+// Armadillo has no way to rebind an existing matrix, so mat is constructed
+// again in place.
+template<typename eT>
+void aliasMemory(Mat<eT>& mat, eT* mem, const u32 height, const u32 width) {
+  mat.~Mat();
+  new (&mat) Mat<eT>(mem, height, width, false, true);
+}
+
+// Process-wide Magick++ context used by the load and save functions.
+// Magick++ is initialized exactly once, on first use, and each thread keeps
+// its own decoder and encoder images so that consecutive calls reuse the same
+// Magick++ objects and their options instead of setting up new ones. At the
+// end of each call, MagickRelease swaps the decoded (or encoded) image for an
+// empty one, so that a thread does not keep the pixel cache of the last image
+// it loaded or saved.
+class MagickContext {
+  public:
+    static MagickContext& instance() {
+      // Initialization of a local static is thread-safe since C++11.
+      static MagickContext context;
+      return context;
+    }
+
+    Magick::Image& decoder() {
+      static thread_local Magick::Image magickImage;
+      return magickImage;
+    }
+
+    Magick::Image& encoder() {
+      static thread_local Magick::Image magickImage;
+      return magickImage;
+    }
+
+  private:
+    MagickContext() { Magick::InitializeMagick(NULL); }
+    MagickContext(const MagickContext&);
+    MagickContext& operator=(const MagickContext&);
+};
+
+// Release the pixels of a decoder or encoder image when going out of scope.
+// replaceImage(NULL) destroys the MagickCore image and its pixel cache and
+// acquires an empty one with the options of the Magick++ image, which is
+// kept.
+class MagickRelease {
+  public:
+    explicit MagickRelease(Magick::Image& magickImage) : magickImage(magickImage) {}
+    ~MagickRelease() {
+      try {
+        magickImage.replaceImage(NULL);
+      }
+      catch (...) {
+      }
+    }
+  private:
+    MagickRelease(const MagickRelease&);
+    MagickRelease& operator=(const MagickRelease&);
+    Magick::Image& magickImage;
+};
+
+// Number of image rows requested from the Magick++ pixel cache at a time by
+// the bulk transfer functions below. A strip is small enough to stay in cache
+// while it is transposed into (or out of) the column-major planes.
+const u32 MAGICK_STRIP_ROWS = 16;
+
+// Scale a Magick++ quantum to the 0 - 255 range used by SENSE images.
+template<typename eT>
+inline eT quantumToValue(const Magick::Quantum quantum) {
+  return (eT)round(quantum * (255.0 / QuantumRange));
+}
+
+// Scale a value in the 0 - 255 range to a Magick++ quantum.
+template<typename eT>
+inline Magick::Quantum valueToQuantum(const eT value) {
+  const double quantum = value * (QuantumRange / 255.0);
+  if (quantum <= 0)
+    return 0;
+  if (quantum >= QuantumRange)
+    return (Magick::Quantum)QuantumRange;
+  return (Magick::Quantum)(quantum + 0.5);
+}
+
+// Copy the pixels of a Magick++ image into R, G, B planes. The planes are
+// column-major, and stride is the distance between the starts of two adjacent
+// columns (the number of rows of the matrix that holds them).
 template<typename eT>
-void convert(ImageRGB<eT>& image, /* const */ Magick::Image& magickImage) {
+void importPixels(eT* r, eT* g, eT* b, const uword stride,
+                  const Magick::Image& magickImage) {
   const u32 height = magickImage.rows();
   const u32 width  = magickImage.columns();
-  Magick::PixelPacket* magickPixels = magickImage.getPixels(0, 0, width, height);
-  image.setSize(height, width);
-  for (u32 y = 0; y < height; y++)
-  for (u32 x = 0; x < width; x++)
-  {
-    Magick::Color magickColor = magickPixels[width * y + x];
-    Magick::ColorRGB magickRgb(magickColor);
-    image.r(y, x) = (eT)round(magickRgb.red() * 255.0);
-    image.g(y, x) = (eT)round(magickRgb.green() * 255.0);
-    image.b(y, x) = (eT)round(magickRgb.blue() * 255.0);
+  for (u32 y0 = 0; y0 < height; y0 += MAGICK_STRIP_ROWS) {
+    const u32 rows = std::min(MAGICK_STRIP_ROWS, height - y0);
+    const Magick::PixelPacket* magickPixels = magickImage.getConstPixels(0, y0, width, rows);
+    for (u32 x = 0; x < width; x++) {
+      const Magick::PixelPacket* magickPixel = magickPixels + x;
+      eT* rCol = r + x * stride + y0;
+      eT* gCol = g + x * stride + y0;
+      eT* bCol = b + x * stride + y0;
+      for (u32 y = 0; y < rows; y++, magickPixel += width) {
+        rCol[y] = quantumToValue<eT>(magickPixel->red);
+        gCol[y] = quantumToValue<eT>(magickPixel->green);
+        bCol[y] = quantumToValue<eT>(magickPixel->blue);
+      }
+    }
   }
 }
 
-// Convert SENSE image to Magick++ image.
+// Copy R, G, B planes (laid out as for importPixels, but with one column stride
+// per plane) into a Magick++ image of the given size.
 template<typename eT>
-void convert(Magick::Image& magickImage, const ImageRGB<eT>& image) {
-  const u32 height = image.height;
-  const u32 width = image.width;
+void exportPixels(Magick::Image& magickImage, const eT* r, const uword rStride, const eT* g, const uword gStride,
+                  const eT* b, const uword bStride, const u32 height, const u32 width) {
   Magick::Geometry magickGeometry(width, height);
   magickImage.size(magickGeometry);
-  Magick::PixelPacket* magickPixels = magickImage.getPixels(0, 0, width, height);
-  for (u32 y = 0; y < height; y++)
-  for (u32 x = 0; x < width; x++)
-  {
-    Magick::ColorRGB magickColor(image.r(y, x) / 255.0, image.g(y, x) / 255.0, image.b(y, x) / 255.0);
-    magickPixels[width * y + x] = magickColor;
+  for (u32 y0 = 0; y0 < height; y0 += MAGICK_STRIP_ROWS) {
+    const u32 rows = std::min(MAGICK_STRIP_ROWS, height - y0);
+    Magick::PixelPacket* magickPixels = magickImage.getPixels(0, y0, width, rows);
+    for (u32 x = 0; x < width; x++) {
+      Magick::PixelPacket* magickPixel = magickPixels + x;
+      const eT* rCol = r + x * rStride + y0;
+      const eT* gCol = g + x * gStride + y0;
+      const eT* bCol = b + x * bStride + y0;
+      for (u32 y = 0; y < rows; y++, magickPixel += width) {
+        magickPixel->red     = valueToQuantum(rCol[y]);
+        magickPixel->green   = valueToQuantum(gCol[y]);
+        magickPixel->blue    = valueToQuantum(bCol[y]);
+        magickPixel->opacity = OpaqueOpacity;
+      }
+    }
+    magickImage.syncPixels();
   }
-  magickImage.syncPixels();
 }
 
-// Convert Magick++ image to grayscale image.
+// Copy the pixels of a Magick++ image into a grayscale plane. Like
+// Magick::ColorGray, the shade is taken from the red channel.
 template<typename eT>
-void convert(Mat<eT>& mat, /* const */ Magick::Image& magickImage) {
+void importGrayPixels(eT* gray, const uword stride, const Magick::Image& magickImage) {
   const u32 height = magickImage.rows();
   const u32 width  = magickImage.columns();
-
-  Magick::PixelPacket* magickPixels = magickImage.getPixels(0, 0, width, height);
-  mat.set_size(height, width);
-  for (u32 y = 0; y < height; y++)
-  for (u32 x = 0; x < width; x++)
-  {
-    Magick::Color magickColor = magickPixels[width * y + x];
-    Magick::ColorGray magickGray(magickColor);
-    mat(y, x) = (eT)round(magickGray.shade() * 255.0);
+  for (u32 y0 = 0; y0 < height; y0 += MAGICK_STRIP_ROWS) {
+    const u32 rows = std::min(MAGICK_STRIP_ROWS, height - y0);
+    const Magick::PixelPacket* magickPixels = magickImage.getConstPixels(0, y0, width, rows);
+    for (u32 x = 0; x < width; x++) {
+      const Magick::PixelPacket* magickPixel = magickPixels + x;
+      eT* grayCol = gray + x * stride + y0;
+      for (u32 y = 0; y < rows; y++, magickPixel += width) {
+        grayCol[y] = quantumToValue<eT>(magickPixel->red);
+      }
+    }
   }
 }
 
-// Convert grayscale image to Magick++ image.
+// Copy a grayscale plane into a Magick++ image of the given size.
 template<typename eT>
-void convert(Magick::Image& magickImage, const Mat<eT>& mat) {
-  const u32 height = mat.n_rows;
-  const u32 width = mat.n_cols;
+void exportGrayPixels(Magick::Image& magickImage, const eT* gray, const uword stride,
+                      const u32 height, const u32 width) {
   Magick::Geometry magickGeometry(width, height);
   magickImage.size(magickGeometry);
-  Magick::PixelPacket* magickPixels = magickImage.getPixels(0, 0, width, height);
-  for (u32 y = 0; y < height; y++)
-  for (u32 x = 0; x < width; x++)
-  {
-    Magick::ColorGray magickColor(mat(y, x) / 255.0);
-    magickPixels[width * y + x] = magickColor;
+  for (u32 y0 = 0; y0 < height; y0 += MAGICK_STRIP_ROWS) {
+    const u32 rows = std::min(MAGICK_STRIP_ROWS, height - y0);
+    Magick::PixelPacket* magickPixels = magickImage.getPixels(0, y0, width, rows);
+    for (u32 x = 0; x < width; x++) {
+      Magick::PixelPacket* magickPixel = magickPixels + x;
+      const eT* grayCol = gray + x * stride + y0;
+      for (u32 y = 0; y < rows; y++, magickPixel += width) {
+        const Magick::Quantum shade = valueToQuantum(grayCol[y]);
+        magickPixel->red     = shade;
+        magickPixel->green   = shade;
+        magickPixel->blue    = shade;
+        magickPixel->opacity = OpaqueOpacity;
+      }
+    }
+    magickImage.syncPixels();
   }
-  magickImage.syncPixels();
+}
+
+// Convert Magick++ image to SENSE image.
+template<typename eT>
+void convert(ImageRGB<eT>& image, const Magick::Image& magickImage) {
+  image.setSize(magickImage.rows(), magickImage.columns());
+  importPixels(image.r.memptr(), image.g.memptr(), image.b.memptr(), image.height, magickImage);
+}
+
+// Convert SENSE image to Magick++ image.
+template<typename eT>
+void convert(Magick::Image& magickImage, const ImageRGB<eT>& image) {
+  exportPixels(magickImage, image.r.memptr(), image.height, image.g.memptr(), image.height,
+               image.b.memptr(), image.height, image.height, image.width);
+}
+
+// Convert Magick++ image to grayscale image.
+template<typename eT>
+void convert(Mat<eT>& mat, const Magick::Image& magickImage) {
+  mat.set_size(magickImage.rows(), magickImage.columns());
+  importGrayPixels(mat.memptr(), mat.n_rows, magickImage);
+}
+
+// Convert grayscale image to Magick++ image.
+template<typename eT>
+void convert(Magick::Image& magickImage, const Mat<eT>& mat) {
+  exportGrayPixels(magickImage, mat.memptr(), mat.n_rows, mat.n_rows, mat.n_cols);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -326,6 +465,199 @@ void ImageYCbCr<eT>::print(ostream& stream) const {
   stream << "Cr: " << endl << cr << endl;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// ImagePacked implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+inline void ImagePacked::setSize(const u32 newHeight, const u32 newWidth) {
+  setSize(newHeight, newWidth, format);
+}
+
+inline void ImagePacked::setSize(const u32 newHeight, const u32 newWidth, const PixelFormat newFormat) {
+  height = newHeight;
+  width  = newWidth;
+  format = newFormat;
+  data.set_size((uword)newHeight * newWidth * channels());
+}
+
+inline bool ImagePacked::check() const {
+  return (data.n_elem == (uword)height * width * channels());
+}
+
+inline void ImagePacked::print(ostream& stream) const {
+  stream << "Height  : " << height << endl;
+  stream << "Width   : " << width  << endl;
+  stream << "Channels: " << channels() << endl;
+  for (u32 y = 0; y < height; y++) {
+    const u8* pixels = row(y);
+    for (uword i = 0; i < rowStride(); i++)
+      stream << (u32)pixels[i] << ((i + 1 < rowStride()) ? " " : "");
+    stream << endl;
+  }
+}
+
+// Magick++ channel map of a pixel format.
+inline string magickMap(const PixelFormat format) {
+  return (format == PIXELFORMAT_RGBA8) ? "RGBA" : "RGB";
+}
+
+// Number of rows of a packed image transposed at a time into (or out of)
+// column-major planes.
+const u32 PACKED_STRIP_ROWS = 16;
+
+// Copy the channels of a packed image into R, G, B planes laid out as for
+// importPixels.
+template<typename eT>
+void unpackPixels(eT* r, eT* g, eT* b, const uword stride, const ImagePacked& image) {
+  const u32 channels = image.channels();
+  const uword rowStride = image.rowStride();
+  const u32 strips = (image.height + PACKED_STRIP_ROWS - 1) / PACKED_STRIP_ROWS;
+  parallelFor(strips, minTileLines((uword)image.width * PACKED_STRIP_ROWS), [&](const uword begin, const uword end) {
+    for (uword strip = begin; strip < end; strip++) {
+      const u32 y0 = strip * PACKED_STRIP_ROWS;
+      const u32 rows = std::min(PACKED_STRIP_ROWS, image.height - y0);
+      for (u32 x = 0; x < image.width; x++) {
+        const u8* pixel = image.row(y0) + x * channels;
+        eT* rCol = r + x * stride + y0;
+        eT* gCol = g + x * stride + y0;
+        eT* bCol = b + x * stride + y0;
+        for (u32 y = 0; y < rows; y++, pixel += rowStride) {
+          rCol[y] = pixel[0];
+          gCol[y] = pixel[1];
+          bCol[y] = pixel[2];
+        }
+      }
+    }
+  });
+}
+
+// Copy R, G, B planes into a packed image that already has the size of the
+// planes. Each plane has its own column stride, as the planes of an
+// ImageRGBRoi may come from matrices of different heights. The alpha
+// channel, if any, is set to opaque.
+template<typename eT>
+void packPixels(ImagePacked& image, const eT* r, const uword rStride, const eT* g, const uword gStride,
+                const eT* b, const uword bStride) {
+  const u32 channels = image.channels();
+  const uword rowStride = image.rowStride();
+  const u32 strips = (image.height + PACKED_STRIP_ROWS - 1) / PACKED_STRIP_ROWS;
+  parallelFor(strips, minTileLines((uword)image.width * PACKED_STRIP_ROWS), [&](const uword begin, const uword end) {
+    for (uword strip = begin; strip < end; strip++) {
+      const u32 y0 = strip * PACKED_STRIP_ROWS;
+      const u32 rows = std::min(PACKED_STRIP_ROWS, image.height - y0);
+      for (u32 x = 0; x < image.width; x++) {
+        u8* pixel = image.row(y0) + x * channels;
+        const eT* rCol = r + x * rStride + y0;
+        const eT* gCol = g + x * gStride + y0;
+        const eT* bCol = b + x * bStride + y0;
+        for (u32 y = 0; y < rows; y++, pixel += rowStride) {
+          pixel[0] = saturateCast<u8>(rCol[y]);
+          pixel[1] = saturateCast<u8>(gCol[y]);
+          pixel[2] = saturateCast<u8>(bCol[y]);
+          if (channels == PIXELFORMAT_RGBA8)
+            pixel[3] = 255;
+        }
+      }
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MatRoi implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+MatRoi<eT>::MatRoi(const Mat<eT>& mat)
+  : mem(mat.memptr()), stride(mat.n_rows), height(mat.n_rows), width(mat.n_cols) {
+}
+
+template<typename eT>
+MatRoi<eT>::MatRoi(const Mat<eT>& mat,
+                   const u32 yOffset, const u32 xOffset, const u32 height, const u32 width)
+  : mem(mat.memptr() + xOffset * mat.n_rows + yOffset), stride(mat.n_rows), height(height), width(width) {
+  if ((uword)yOffset + height > mat.n_rows || (uword)xOffset + width > mat.n_cols)
+    throw logic_error("Region of interest exceeds the matrix");
+}
+
+template<typename eT>
+MatRoi<eT>::MatRoi(const eT* mem, const uword stride, const u32 height, const u32 width)
+  : mem(mem), stride(stride), height(height), width(width) {
+}
+
+template<typename eT>
+bool MatRoi<eT>::overlaps(const Mat<eT>& mat) const {
+  if (mat.n_elem == 0 || height == 0 || width == 0)
+    return false;
+  const eT* last = mem + (width - 1) * stride + height;
+  return (mem < mat.memptr() + mat.n_elem && mat.memptr() < last);
+}
+
+template<typename eT>
+void MatRoi<eT>::copyTo(Mat<eT>& matOut) const {
+  if (overlaps(matOut)) {
+    // Resizing matOut could free the memory of the region.
+    Mat<eT> matCopy;
+    copyTo(matCopy);
+    matOut = matCopy;
+    return;
+  }
+  matOut.set_size(height, width);
+  if (isContiguous()) {
+    std::copy(mem, mem + (uword)height * width, matOut.memptr());
+    return;
+  }
+  for (u32 x = 0; x < width; x++)
+    std::copy(colptr(x), colptr(x) + height, matOut.colptr(x));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ImageRGBRoi implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+ImageRGBRoi<eT>::ImageRGBRoi(const ImageRGB<eT>& image)
+  : height(image.height), width(image.width), r(image.r), g(image.g), b(image.b) {
+}
+
+template<typename eT>
+ImageRGBRoi<eT>::ImageRGBRoi(const ImageRGB<eT>& image,
+                             const u32 yOffset, const u32 xOffset, const u32 height, const u32 width)
+  : height(height), width(width),
+    r(image.r, yOffset, xOffset, height, width),
+    g(image.g, yOffset, xOffset, height, width),
+    b(image.b, yOffset, xOffset, height, width) {
+}
+
+template<typename eT>
+ImageRGBRoi<eT>::ImageRGBRoi(const MatRoi<eT>& r, const MatRoi<eT>& g, const MatRoi<eT>& b)
+  : height(r.height), width(r.width), r(r), g(g), b(b) {
+  if (!(g.height == height && b.height == height && g.width == width && b.width == width))
+    throw logic_error("Inconsistent height and width in planes");
+}
+
+template<typename eT>
+void ImageRGBRoi<eT>::copyTo(ImageRGB<eT>& imageOut) const {
+  r.copyTo(imageOut.r);
+  g.copyTo(imageOut.g);
+  b.copyTo(imageOut.b);
+  imageOut.height = height;
+  imageOut.width  = width;
+}
+
+template<typename eT>
+MatRoi<eT> roi(const Mat<eT>& mat,
+               const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
+  return MatRoi<eT>(mat, yOffset, xOffset, height, width);
+}
+
+template<typename eT>
+ImageRGBRoi<eT> roi(const ImageRGB<eT>& image,
+                    const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
+  if (!image.check())
+    throw logic_error("Inconsistent height and width in image");
+  return ImageRGBRoi<eT>(image, yOffset, xOffset, height, width);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Overloaded operators.
 ////////////////////////////////////////////////////////////////////////////////
@@ -342,11 +674,9 @@ ostream& operator<<(ostream& stream, const Image<eT>& image) {
 
 template<typename eT>
 bool load(ImageRGB<eT>& image, const string& path) {
-  // Initialize Magick++.
-  Magick::InitializeMagick(NULL);
-
   // Load Magick++ image.
-  Magick::Image magickImage;
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
   try {
     magickImage.read(path);
   }
@@ -374,19 +704,53 @@ bool load(Image<eT>& image, const string& path) {
   }
 }
 
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value, bool>::type
+load(ImageT& image, const string& path) {
+  ImageRGB<typename ImageT::elem_type> imageRgb;
+  if (!load(imageRgb, path))
+    return false;
+  convert(image, imageRgb);
+  return true;
+}
+
 template<typename eT>
-bool save(ImageRGB<eT>& image, const string& path) {
+bool save(const ImageRGB<eT>& image, const string& path) {
   if (!image.check())
     throw logic_error("Inconsistent height and width in image");
-  if (image.height == 0 || image.width == 0)
-    return false;
+  return save(ImageRGBRoi<eT>(image), path);
+}
+
+template<typename eT>
+bool save(const Image<eT>& image, const string& path) {
+  if (image.colorSpace() == COLORSPACE_RGB) {
+    return save(static_cast<const ImageRGB<eT>&>(image), path);
+  }
+  else {
+    ImageRGB<eT> imageRgb;
+    convert(imageRgb, image);
+    return save(imageRgb, path);
+  }
+}
+
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value, bool>::type
+save(const ImageT& image, const string& path) {
+  ImageRGB<typename ImageT::elem_type> imageRgb;
+  convert(imageRgb, image);
+  return save(imageRgb, path);
+}
 
-  // Initialize Magick++.
-  Magick::InitializeMagick(NULL);
+template<typename eT>
+bool save(const ImageRGBRoi<eT>& roi, const string& path) {
+  if (roi.height == 0 || roi.width == 0)
+    return false;
 
   // Convert SENSE image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, image);
+  Magick::Image& magickImage = MagickContext::instance().encoder();
+  MagickRelease release(magickImage);
+  exportPixels(magickImage, roi.r.mem, roi.r.stride, roi.g.mem, roi.g.stride, roi.b.mem, roi.b.stride,
+               roi.height, roi.width);
 
   // Save Magick++ image.
   try {
@@ -399,29 +763,15 @@ bool save(ImageRGB<eT>& image, const string& path) {
   return true;
 }
 
-template<typename eT>
-bool save(const Image<eT>& image, const string& path) {
-  if (image.colorSpace() == COLORSPACE_RGB) {
-    return save(static_cast<const ImageRGB<eT>&>(image), path);
-  }
-  else {
-    ImageRGB<eT> imageRgb;
-    convert(imageRgb, image);
-    return save(imageRgb, path);
-  }
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // Functions to load and save grayscale images in the form of Mat<eT> objects.
 ////////////////////////////////////////////////////////////////////////////////
 
 template<typename eT>
 bool load(Mat<eT>& mat, const string& path) {
-  // Initialize Magick++.
-  Magick::InitializeMagick(NULL);
-
   // Load Magick++ image.
-  Magick::Image magickImage;
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
   try {
     magickImage.read(path);
   }
@@ -437,12 +787,15 @@ bool load(Mat<eT>& mat, const string& path) {
 
 template<typename eT>
 bool save(const Mat<eT>& mat, const string& path) {
-  // Initialize Magick++.
-  Magick::InitializeMagick(NULL);
+  return save(MatRoi<eT>(mat), path);
+}
 
+template<typename eT>
+bool save(const MatRoi<eT>& roi, const string& path) {
   // Convert grayscale image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, mat);
+  Magick::Image& magickImage = MagickContext::instance().encoder();
+  MagickRelease release(magickImage);
+  exportGrayPixels(magickImage, roi.mem, roi.stride, roi.height, roi.width);
 
   // Save Magick++ image.
   try {
@@ -456,122 +809,419 @@ bool save(const Mat<eT>& mat, const string& path) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Resize color images in the form of ImageRGB<eT> objects.
+// Functions to load and save color images in the form of ImagePacked objects.
 ////////////////////////////////////////////////////////////////////////////////
 
-template<typename eT>
-bool resize(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
-            const u32 height, const u32 width) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+// Copy the pixels of a Magick++ image into a packed image, keeping its pixel
+// format.
+inline void convert(ImagePacked& image, const Magick::Image& magickImage) {
+  image.setSize(magickImage.rows(), magickImage.columns());
+  if (image.height > 0 && image.width > 0)
+    magickImage.write(0, 0, image.width, image.height, magickMap(image.format),
+                      Magick::CharPixel, image.data.memptr());
+}
 
-  // Special handling for zero height or width.
-  if (height == 0 || width == 0) {
-    imageOut.setSize(0, 0);
-    return true;
+inline bool load(ImagePacked& image, const string& path) {
+  // Load Magick++ image.
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
+  try {
+    magickImage.read(path);
+
+    // Export the pixels straight into the packed image.
+    convert(image, magickImage);
+  }
+  catch (const Magick::Error& error) {
+    return false;
   }
 
-  // Convert SENSE image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, imageIn);
+  return true;
+}
 
-  // Resize image.
-  Magick::Geometry magickGeometry(width, height);
-  magickGeometry.aspect(true);
-  magickImage.resize(magickGeometry);
+inline bool save(const ImagePacked& image, const string& path) {
+  if (!image.check())
+    throw logic_error("Inconsistent height and width in image");
+  if (image.height == 0 || image.width == 0)
+    return false;
 
-  // Convert Magick++ image to SENSE image.
-  convert(imageOut, magickImage);
+  // Import the packed pixels into the encoder and save it.
+  Magick::Image& magickImage = MagickContext::instance().encoder();
+  MagickRelease release(magickImage);
+  try {
+    magickImage.read(image.width, image.height, magickMap(image.format),
+                     Magick::CharPixel, image.data.memptr());
+    magickImage.write(path);
+  }
+  catch (const Magick::Error& error) {
+    return false;
+  }
 
   return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Resize grayscale images in the form of Mat<eT> objects.
+// Functions to load images strip by strip.
 ////////////////////////////////////////////////////////////////////////////////
 
-template<typename eT>
-bool resize(Mat<eT>& matOut, const Mat<eT>& matIn,
-            const u32 height, const u32 width) {
-  // Special handling for zero height or width.
-  if (height == 0 || width == 0) {
-    matOut.set_size(0, 0);
-    return true;
-  }
+// Receiver of the rows streamed by MagickCore::ReadStream. The stream handler
+// has no argument for user data, so the receiver of the thread is kept in
+// current() for the duration of the call.
+class StripStream {
+  public:
+    virtual size_t addRow(const MagickCore::Image* image, const Magick::PixelPacket* pixels,
+                          const size_t columns) = 0;
+
+    static StripStream*& current() {
+      static thread_local StripStream* stream = NULL;
+      return stream;
+    }
 
-  // Convert grayscale image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, matIn);
+    static size_t handler(const MagickCore::Image* image, const void* pixels, const size_t columns) {
+      // The first call, made before any row is decoded, has no pixels.
+      if (pixels == NULL)
+        return columns;
+      return current()->addRow(image, (const Magick::PixelPacket*)pixels, columns);
+    }
+};
+
+template<typename eT>
+class StripStreamRGB: public StripStream {
+  public:
+    ImageRGB<eT>& strip;
+    const u32 stripRows;
+    const function<bool(const u32)>& process;
+    u32 y;  // Image row of the next row
+    u32 rowInStrip;
+    bool failed;
+    exception_ptr error;
+
+    StripStreamRGB(ImageRGB<eT>& strip, const u32 stripRows, const function<bool(const u32)>& process)
+      : strip(strip), stripRows(stripRows), process(process), y(0), rowInStrip(0), failed(false) {}
+
+    // Returning less than columns makes the decoder stop with an error.
+    size_t addRow(const MagickCore::Image* image, const Magick::PixelPacket* pixels, const size_t columns) {
+      const u32 height = image->rows;
+      const u32 width = image->columns;
+      if (failed || columns != width || y >= height) {
+        failed = true;
+        return 0;
+      }
+
+      if (rowInStrip == 0)
+        strip.setSize(std::min(stripRows, height - y), width);
+      const uword stride = strip.height;
+      eT* r = strip.r.memptr() + rowInStrip;
+      eT* g = strip.g.memptr() + rowInStrip;
+      eT* b = strip.b.memptr() + rowInStrip;
+      for (u32 x = 0; x < width; x++) {
+        r[x * stride] = quantumToValue<eT>(pixels[x].red);
+        g[x * stride] = quantumToValue<eT>(pixels[x].green);
+        b[x * stride] = quantumToValue<eT>(pixels[x].blue);
+      }
+      y++;
+      rowInStrip++;
+
+      if (rowInStrip == strip.height) {
+        // Exceptions must not unwind through the decoder, which is C code.
+        try {
+          if (!process(y - rowInStrip)) {
+            failed = true;
+            return 0;
+          }
+        }
+        catch (...) {
+          error = current_exception();
+          failed = true;
+          return 0;
+        }
+        rowInStrip = 0;
+      }
+      return columns;
+    }
+};
 
-  // Resize image.
-  Magick::Geometry magickGeometry(width, height);
-  magickGeometry.aspect(true);
-  magickImage.resize(magickGeometry);
+template<typename eT>
+bool loadStrips(ImageRGB<eT>& strip, const string& path, const u32 stripRows,
+                const function<bool(const u32 y)>& process) {
+  if (stripRows == 0)
+    throw logic_error("Strips must have at least one row");
+  MagickContext::instance();
 
-  // Convert Magick++ image to grayscale image.
-  convert(matOut, magickImage);
+  StripStreamRGB<eT> stream(strip, stripRows, process);
+  StripStream* const previous = StripStream::current();
+  StripStream::current() = &stream;
 
-  return true;
+  MagickCore::ImageInfo* imageInfo = MagickCore::AcquireImageInfo();
+  MagickCore::ExceptionInfo* exceptionInfo = MagickCore::AcquireExceptionInfo();
+  MagickCore::CopyMagickString(imageInfo->filename, path.c_str(), MaxTextExtent);
+  MagickCore::Image* image = MagickCore::ReadStream(imageInfo, &StripStream::handler, exceptionInfo);
+  const bool decoded = (image != NULL && exceptionInfo->severity < MagickCore::ErrorException);
+  const bool complete = (image != NULL && stream.y == image->rows);
+  if (image != NULL)
+    MagickCore::DestroyImage(image);
+  MagickCore::DestroyExceptionInfo(exceptionInfo);
+  MagickCore::DestroyImageInfo(imageInfo);
+
+  StripStream::current() = previous;
+  if (stream.error)
+    rethrow_exception(stream.error);
+  return (decoded && complete && !stream.failed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Crop color images in the form of ImageRGB<eT> objects.
+// Functions to load images at reduced size.
 ////////////////////////////////////////////////////////////////////////////////
 
+// Read an image into the decoder, letting decoders that can scale while
+// decoding stop at the smallest size they support that is at least
+// height x width. The hint is an option of the decoder, so it is removed
+// again for the next read.
+inline bool readReduced(Magick::Image& magickImage, const string& path, const u32 height, const u32 width) {
+  const bool hint = (height > 0 && width > 0);
+  if (hint) {
+    ostringstream size;
+    size << width << "x" << height;
+    magickImage.defineValue("jpeg", "size", size.str());
+  }
+  bool success = true;
+  try {
+    magickImage.read(path);
+  }
+  catch (const Magick::Error& error) {
+    success = false;
+  }
+  if (hint)
+    magickImage.defineSet("jpeg", "size", false);
+  return success;
+}
+
+// Size of the image at path times scale, from its header.
+inline bool scaledSize(const string& path, const double scale, u32& height, u32& width) {
+  if (!(scale > 0))
+    throw logic_error("Scale must be greater than 0");
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
+  try {
+    magickImage.ping(path);
+  }
+  catch (const Magick::Error& error) {
+    return false;
+  }
+  height = std::max((u32)round(magickImage.rows() * scale), (u32)1);
+  width = std::max((u32)round(magickImage.columns() * scale), (u32)1);
+  return true;
+}
+
 template<typename eT>
-bool crop(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
-          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
-  if (yOffset + height > imageIn.height || xOffset + width > imageIn.width)
+bool load(ImageRGB<eT>& image, const string& path,
+          const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
+  if (!readReduced(magickImage, path, height, width))
     return false;
+  if (magickImage.rows() == height && magickImage.columns() == width) {
+    convert(image, magickImage);
+    return true;
+  }
+  ImageRGB<eT> decoded;
+  convert(decoded, magickImage);
+  return resize(image, decoded, height, width, filter);
+}
 
-  // Special handling for zero height or width.
-  if (height == 0 || width == 0) {
-    imageOut.setSize(0, 0);
+template<typename eT>
+bool load(Mat<eT>& mat, const string& path,
+          const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
+  if (!readReduced(magickImage, path, height, width))
+    return false;
+  if (magickImage.rows() == height && magickImage.columns() == width) {
+    convert(mat, magickImage);
     return true;
   }
+  Mat<eT> decoded;
+  convert(decoded, magickImage);
+  return resize(mat, decoded, height, width, filter);
+}
 
-  // Convert SENSE image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, imageIn);
+inline bool load(ImagePacked& image, const string& path,
+                 const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  Magick::Image& magickImage = MagickContext::instance().decoder();
+  MagickRelease release(magickImage);
+  if (!readReduced(magickImage, path, height, width))
+    return false;
+  ImagePacked decoded(0, 0, image.format);
+  try {
+    if (magickImage.rows() == height && magickImage.columns() == width) {
+      convert(image, magickImage);
+      return true;
+    }
+    convert(decoded, magickImage);
+  }
+  catch (const Magick::Error& error) {
+    return false;
+  }
+  return resize(image, decoded, height, width, filter);
+}
 
-  // Crop image.
-  Magick::Geometry magickGeometry(width, height, xOffset, yOffset);
-  magickImage.crop(magickGeometry);
+template<typename eT>
+bool load(ImageRGB<eT>& image, const string& path,
+          const double scale, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  u32 height, width;
+  if (!scaledSize(path, scale, height, width))
+    return false;
+  return load(image, path, height, width, filter);
+}
 
-  // Convert Magick++ image to SENSE image.
-  convert(imageOut, magickImage);
+template<typename eT>
+bool load(Mat<eT>& mat, const string& path,
+          const double scale, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  u32 height, width;
+  if (!scaledSize(path, scale, height, width))
+    return false;
+  return load(mat, path, height, width, filter);
+}
 
-  return true;
+inline bool load(ImagePacked& image, const string& path,
+                 const double scale, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  u32 height, width;
+  if (!scaledSize(path, scale, height, width))
+    return false;
+  return load(image, path, height, width, filter);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Crop grayscale images in the form of Mat<eT> objects.
+// Resize color images in the form of ImageRGB<eT> objects.
 ////////////////////////////////////////////////////////////////////////////////
 
 template<typename eT>
-bool crop(Mat<eT>& matOut, const Mat<eT>& matIn,
-          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
-  if (yOffset + height > matIn.n_rows || xOffset + width > matIn.n_cols)
-    return false;
+bool resize(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+            const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  // The three planes share the same filter weights and scratch plane.
+  Resizer<eT> resizer;
+  return resize(resizer, imageOut, imageIn, height, width, filter);
+}
 
-  // Special handling for zero height or width.
+template<typename eT>
+bool resize(Resizer<eT>& resizer, ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+            const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+
+  // Special handling for zero height or width.
+  if (height == 0 || width == 0) {
+    imageOut.setSize(0, 0);
+    return true;
+  }
+  if (imageIn.height == 0 || imageIn.width == 0)
+    return false;
+
+  resizer.resize(imageOut.r, imageIn.r, height, width, filter);
+  resizer.resize(imageOut.g, imageIn.g, height, width, filter);
+  resizer.resize(imageOut.b, imageIn.b, height, width, filter);
+  imageOut.height = height;
+  imageOut.width  = width;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Resize grayscale images in the form of Mat<eT> objects.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+bool resize(Mat<eT>& matOut, const Mat<eT>& matIn,
+            const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  Resizer<eT> resizer;
+  return resize(resizer, matOut, matIn, height, width, filter);
+}
+
+template<typename eT>
+bool resize(Resizer<eT>& resizer, Mat<eT>& matOut, const Mat<eT>& matIn,
+            const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  // Special handling for zero height or width.
   if (height == 0 || width == 0) {
     matOut.set_size(0, 0);
     return true;
   }
+  if (matIn.n_rows == 0 || matIn.n_cols == 0)
+    return false;
 
-  // Convert grayscale image to Magick++ image.
-  Magick::Image magickImage;
-  convert(magickImage, matIn);
+  resizer.resize(matOut, matIn, height, width, filter);
+
+  return true;
+}
 
-  // Crop image.
-  Magick::Geometry magickGeometry(width, height, xOffset, yOffset);
-  magickImage.crop(magickGeometry);
+////////////////////////////////////////////////////////////////////////////////
+// Resize color images in the form of ImagePacked objects.
+////////////////////////////////////////////////////////////////////////////////
 
-  // Convert Magick++ image to grayscale image.
-  convert(matOut, magickImage);
+inline bool resize(ImagePacked& imageOut, const ImagePacked& imageIn,
+                   const u32 height, const u32 width, const ResizeFilter filter /* default: RESIZE_LANCZOS */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+
+  // Special handling for zero height or width.
+  if (height == 0 || width == 0) {
+    imageOut.setSize(0, 0, imageIn.format);
+    return true;
+  }
+  if (imageIn.height == 0 || imageIn.width == 0)
+    return false;
+
+  if (&imageOut == &imageIn) {
+    const ImagePacked imageCopy(imageIn);
+    return resize(imageOut, imageCopy, height, width, filter);
+  }
+
+  imageOut.setSize(height, width, imageIn.format);
+  Resizer<u8> resizer;
+  resizer.resizeInterleaved(imageOut.data.memptr(), imageIn.data.memptr(),
+                            imageIn.height, imageIn.width, height, width, imageIn.channels(), filter);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Crop color images in the form of ImageRGB<eT> objects.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+bool crop(ImageRGB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  if (yOffset + height > imageIn.height || xOffset + width > imageIn.width)
+    return false;
+
+  // Special handling for zero height or width.
+  if (height == 0 || width == 0) {
+    imageOut.setSize(0, 0);
+    return true;
+  }
+
+  ImageRGBRoi<eT>(imageIn, yOffset, xOffset, height, width).copyTo(imageOut);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Crop grayscale images in the form of Mat<eT> objects.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+bool crop(Mat<eT>& matOut, const Mat<eT>& matIn,
+          const u32 yOffset, const u32 xOffset, const u32 height, const u32 width) {
+  if (yOffset + height > matIn.n_rows || xOffset + width > matIn.n_cols)
+    return false;
+
+  // Special handling for zero height or width.
+  if (height == 0 || width == 0) {
+    matOut.set_size(0, 0);
+    return true;
+  }
+
+  MatRoi<eT>(matIn, yOffset, xOffset, height, width).copyTo(matOut);
 
   return true;
 }
@@ -580,396 +1230,1515 @@ bool crop(Mat<eT>& matOut, const Mat<eT>& matIn,
 // Threshold images in the form of Mat<eT> objects.
 ////////////////////////////////////////////////////////////////////////////////
 
+template<typename eT>
+struct ThresholdPixels {
+  typedef void (*Function)(const eT*, eT*, const uword, const eT, const eT, const eT);
+  static SENSE_FORCE_INLINE void run(const eT* in, eT* out, const uword n,
+                                     const eT cutoff, const eT belowCutoffValue, const eT aboveCutoffValue) {
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
+      out[i] = ((in[i] > cutoff) ? aboveCutoffValue : belowCutoffValue);
+  }
+};
+
+// Pixels are processed in blocks, one cutoff at a time, so that the loops
+// vectorize whatever the number of cutoffs.
+template<typename eT>
+struct ThresholdLevelsPixels {
+  typedef void (*Function)(const eT*, eT*, const uword, const eT*, const eT*, const u32);
+  static SENSE_FORCE_INLINE void run(const eT* in, eT* out, const uword n,
+                                     const eT* cutoffs, const eT* values, const u32 cutoffCount) {
+    const uword blockSize = 256;
+    eT block[blockSize];
+    for (uword begin = 0; begin < n; begin += blockSize) {
+      const uword count = std::min(blockSize, n - begin);
+      const eT* blockIn = in + begin;
+      for (uword i = 0; i < count; i++)
+        block[i] = values[0];
+      for (u32 k = 0; k < cutoffCount; k++) {
+        const eT cutoff = cutoffs[k];
+        const eT value = values[k + 1];
+        SENSE_IVDEP
+        for (uword i = 0; i < count; i++)
+          block[i] = ((blockIn[i] > cutoff) ? value : block[i]);
+      }
+      memcpy(out + begin, block, count * sizeof(eT));
+    }
+  }
+};
+
+// Whether matOut is a region of the matrix roiIn refers to other than the
+// region itself, so that roiIn must be copied before it is thresholded.
+template<typename eT>
+bool overlapsOtherRegion(const MatRoi<eT>& roiIn, const Mat<eT>& matOut) {
+  return (roiIn.overlaps(matOut) && !(roiIn.mem == matOut.memptr() && roiIn.isContiguous() &&
+                                      matOut.n_rows == roiIn.height && matOut.n_cols == roiIn.width));
+}
+
+// Call kernel(in, out, n) for the pixels of roiIn, in parallel. The output
+// matrix must already have the size of the region.
+template<typename eT, class Kernel>
+void thresholdPixels(const Kernel& kernel, Mat<eT>& matOut, const MatRoi<eT>& roiIn) {
+  if (roiIn.isContiguous()) {
+    parallelFor((uword)roiIn.height * roiIn.width, minTilePixels(), [&](const uword begin, const uword end) {
+      kernel(roiIn.mem + begin, matOut.memptr() + begin, end - begin);
+    });
+    return;
+  }
+  parallelFor(roiIn.width, minTileLines(roiIn.height), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++)
+      kernel(roiIn.colptr(x), matOut.colptr(x), roiIn.height);
+  });
+}
+
 template<typename eT>
 bool threshold(Mat<eT>& matOut, const Mat<eT>& matIn,
                const eT cutoff, const eT belowCutoffValue /* default: 0 */, const eT aboveCutoffValue /* default: 255 */) {
-  const u32 height = matIn.n_rows;
-  const u32 width = matIn.n_cols;
-  matOut.set_size(height, width);
-  for (u32 y = 0; y < height; y++)
-  for (u32 x = 0; x < width; x++)
-  {
-    matOut(y, x) = ((matIn(y, x) > cutoff) ? aboveCutoffValue : belowCutoffValue);
+  return threshold(matOut, MatRoi<eT>(matIn), cutoff, belowCutoffValue, aboveCutoffValue);
+}
+
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const MatRoi<eT>& roiIn,
+               const eT cutoff, const eT belowCutoffValue /* default: 0 */, const eT aboveCutoffValue /* default: 255 */) {
+  // Thresholding in place is fine, but not into a different region of the
+  // same matrix.
+  if (overlapsOtherRegion(roiIn, matOut)) {
+    Mat<eT> matCopy;
+    roiIn.copyTo(matCopy);
+    return threshold(matOut, matCopy, cutoff, belowCutoffValue, aboveCutoffValue);
+  }
+
+  matOut.set_size(roiIn.height, roiIn.width);
+  const typename ThresholdPixels<eT>::Function kernel = SimdKernel<ThresholdPixels<eT> >::select();
+  thresholdPixels([&](const eT* in, eT* out, const uword n) {
+    kernel(in, out, n, cutoff, belowCutoffValue, aboveCutoffValue);
+  }, matOut, roiIn);
+  return true;
+}
+
+template<typename eT>
+bool threshold(Mat<eT>& mat, const eT cutoff,
+               const eT belowCutoffValue /* default: 0 */, const eT aboveCutoffValue /* default: 255 */) {
+  return threshold(mat, MatRoi<eT>(mat), cutoff, belowCutoffValue, aboveCutoffValue);
+}
+
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<eT>& cutoffs, const vector<eT>& values) {
+  return threshold(matOut, MatRoi<eT>(matIn), cutoffs, values);
+}
+
+template<typename eT>
+bool threshold(Mat<eT>& matOut, const MatRoi<eT>& roiIn, const vector<eT>& cutoffs, const vector<eT>& values) {
+  if (values.size() != cutoffs.size() + 1)
+    throw logic_error("There must be one more value than cutoffs");
+  for (size_t k = 1; k < cutoffs.size(); k++) {
+    if (!(cutoffs[k - 1] <= cutoffs[k]))
+      throw logic_error("Cutoffs must be in increasing order");
+  }
+
+  if (overlapsOtherRegion(roiIn, matOut)) {
+    Mat<eT> matCopy;
+    roiIn.copyTo(matCopy);
+    return threshold(matOut, matCopy, cutoffs, values);
   }
+
+  matOut.set_size(roiIn.height, roiIn.width);
+  const typename ThresholdLevelsPixels<eT>::Function kernel = SimdKernel<ThresholdLevelsPixels<eT> >::select();
+  thresholdPixels([&](const eT* in, eT* out, const uword n) {
+    kernel(in, out, n, cutoffs.data(), values.data(), (u32)cutoffs.size());
+  }, matOut, roiIn);
   return true;
 }
 
+template<typename eT>
+bool threshold(Mat<eT>& mat, const vector<eT>& cutoffs, const vector<eT>& values) {
+  return threshold(mat, MatRoi<eT>(mat), cutoffs, values);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-// Functions to convert image of other color space to RGB.
+// Functions to choose thresholds.
+////////////////////////////////////////////////////////////////////////////////
+
+const u32 HISTOGRAM_BINS = 256;
+
+template<typename eT>
+SENSE_FORCE_INLINE u32 histogramBin(const eT value) {
+  if (is_same<eT, u8>::value)
+    return (u32)value;
+  return (value >= 255) ? 255 : ((value > 0) ? (u32)(value + 0.5) : 0);
+}
+
+// Count pixels into counts. Consecutive pixels of long runs go to four
+// separate histograms, so that runs of equal values do not wait on the same
+// counter.
+template<typename eT>
+void histogramPixels(uword* counts, const eT* in, const uword n) {
+  if (n < 4 * HISTOGRAM_BINS) {
+    for (uword i = 0; i < n; i++)
+      counts[histogramBin(in[i])]++;
+    return;
+  }
+  uword sub[4][HISTOGRAM_BINS] = {};
+  uword i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sub[0][histogramBin(in[i])]++;
+    sub[1][histogramBin(in[i + 1])]++;
+    sub[2][histogramBin(in[i + 2])]++;
+    sub[3][histogramBin(in[i + 3])]++;
+  }
+  for (; i < n; i++)
+    sub[0][histogramBin(in[i])]++;
+  for (u32 k = 0; k < HISTOGRAM_BINS; k++)
+    counts[k] += sub[0][k] + sub[1][k] + sub[2][k] + sub[3][k];
+}
+
+template<typename eT>
+void histogram(Col<uword>& counts, const Mat<eT>& mat) {
+  histogram(counts, MatRoi<eT>(mat));
+}
+
+template<typename eT>
+void histogram(Col<uword>& counts, const MatRoi<eT>& roi) {
+  counts.set_size(HISTOGRAM_BINS);
+  counts.zeros();
+
+  // Each band counts into a histogram of its own and adds it to counts.
+  mutex countsLock;
+  const auto addCounts = [&](const uword* bandCounts) {
+    lock_guard<mutex> guard(countsLock);
+    for (u32 k = 0; k < HISTOGRAM_BINS; k++)
+      counts[k] += bandCounts[k];
+  };
+
+  if (roi.isContiguous()) {
+    parallelFor((uword)roi.height * roi.width, minTilePixels(), [&](const uword begin, const uword end) {
+      uword bandCounts[HISTOGRAM_BINS] = {};
+      histogramPixels(bandCounts, roi.mem + begin, end - begin);
+      addCounts(bandCounts);
+    });
+    return;
+  }
+  parallelFor(roi.width, minTileLines(roi.height), [&](const uword begin, const uword end) {
+    uword bandCounts[HISTOGRAM_BINS] = {};
+    for (uword x = begin; x < end; x++)
+      histogramPixels(bandCounts, roi.colptr(x), roi.height);
+    addCounts(bandCounts);
+  });
+}
+
+inline u32 otsuCutoff(const Col<uword>& counts) {
+  return otsuCutoffs(counts, 2)[0];
+}
+
+// Maximizing the variance between classes is maximizing the sum over the
+// classes of (sum of values)^2 / (number of pixels). best[c][j] is the
+// largest such sum for bins 0 - j-1 split into c + 1 classes, and start[c][j]
+// the first bin of the last of them.
+inline vector<u32> otsuCutoffs(const Col<uword>& counts, const u32 classes) {
+  if (counts.n_elem != HISTOGRAM_BINS)
+    throw logic_error("Histogram must have 256 bins");
+  if (classes < 2 || classes > HISTOGRAM_BINS)
+    throw logic_error("Number of classes must be in 2 - 256");
+
+  const u32 bins = HISTOGRAM_BINS;
+  vector<double> pixels(bins + 1, 0.0);
+  vector<double> sums(bins + 1, 0.0);
+  for (u32 k = 0; k < bins; k++) {
+    pixels[k + 1] = pixels[k] + counts[k];
+    sums[k + 1] = sums[k] + (double)k * counts[k];
+  }
+  const auto score = [&](const u32 begin, const u32 end) {
+    const double n = pixels[end] - pixels[begin];
+    const double sum = sums[end] - sums[begin];
+    return (n > 0) ? sum * sum / n : 0.0;
+  };
+
+  vector<vector<double> > best(classes, vector<double>(bins + 1, 0.0));
+  vector<vector<u32> > start(classes, vector<u32>(bins + 1, 0));
+  for (u32 j = 1; j <= bins; j++)
+    best[0][j] = score(0, j);
+  for (u32 c = 1; c < classes; c++) {
+    for (u32 j = c + 1; j <= bins; j++) {
+      double bestScore = -1;
+      for (u32 i = c; i < j; i++) {
+        const double candidate = best[c - 1][i] + score(i, j);
+        if (candidate > bestScore) {
+          bestScore = candidate;
+          start[c][j] = i;
+        }
+      }
+      best[c][j] = bestScore;
+    }
+  }
+
+  vector<u32> cutoffs(classes - 1);
+  u32 end = bins;
+  for (u32 c = classes - 1; c > 0; c--) {
+    end = start[c][end];
+    cutoffs[c - 1] = end - 1;
+  }
+  return cutoffs;
+}
+
+// Cutoff of histogram bin k for pixels of type eT.
+template<typename eT>
+eT binCutoff(const u32 k) {
+  return is_integral<eT>::value ? (eT)k : (eT)(k + 0.5);
+}
+
+template<typename eT>
+eT otsuCutoff(const Mat<eT>& mat) {
+  Col<uword> counts;
+  histogram(counts, mat);
+  return binCutoff<eT>(otsuCutoff(counts));
+}
+
+template<typename eT>
+vector<eT> otsuCutoffs(const Mat<eT>& mat, const u32 classes) {
+  Col<uword> counts;
+  histogram(counts, mat);
+  const vector<u32> bins = otsuCutoffs(counts, classes);
+  vector<eT> cutoffs(bins.size());
+  for (size_t k = 0; k < bins.size(); k++)
+    cutoffs[k] = binCutoff<eT>(bins[k]);
+  return cutoffs;
+}
+
+template<typename eT>
+bool thresholdOtsu(Mat<eT>& matOut, const Mat<eT>& matIn,
+                   const eT belowCutoffValue /* default: 0 */, const eT aboveCutoffValue /* default: 255 */) {
+  return threshold(matOut, matIn, otsuCutoff(matIn), belowCutoffValue, aboveCutoffValue);
+}
+
+template<typename eT>
+bool thresholdOtsu(Mat<eT>& matOut, const Mat<eT>& matIn, const vector<eT>& values) {
+  return threshold(matOut, matIn, otsuCutoffs(matIn, (u32)values.size()), values);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion mode.
+////////////////////////////////////////////////////////////////////////////////
+
+inline atomic<int>& globalConversionMode() {
+  static atomic<int> mode(CONVERSION_EXACT);
+  return mode;
+}
+
+inline void setConversionMode(const ConversionMode mode) {
+  if (mode != CONVERSION_EXACT && mode != CONVERSION_FAST)
+    throw logic_error("Global conversion mode must be CONVERSION_EXACT or CONVERSION_FAST");
+  globalConversionMode().store(mode, memory_order_relaxed);
+}
+
+inline ConversionMode conversionMode() {
+  return (ConversionMode)globalConversionMode().load(memory_order_relaxed);
+}
+
+inline bool useFastConversion(const ConversionMode mode) {
+  return (((mode == CONVERSION_DEFAULT) ? conversionMode() : mode) == CONVERSION_FAST);
+}
+
+// Tables used by CONVERSION_FAST and by images with integer elements, built
+// once on first use.
+class FastColorTables {
+  public:
+    // linear[i] is the linear RGB value (0 - 1) of the sRGB value i / 16
+    // (0 - 255), so every integer sRGB value falls exactly on an entry.
+    static const u32 LINEAR_STEPS = 16;
+    double linear[255 * LINEAR_STEPS + 2];
+
+    // An sRGB value rounds to k + 1 or more when its linear value is at least
+    // encodeThreshold[k].
+    double encodeThreshold[255];
+
+    // Fixed-point tables of integer images, with FIXED_ONE standing for 1.
+    // fixedLinear[v] is the linear RGB value of the sRGB value v. fixedEncode
+    // (sRGB values times 256) and fixedCubeRoot (the L*a*b* function f) are
+    // sampled over 0 - FIXED_ONE at every 2^FIXED_STEP_BITS. fixedToXyz (14
+    // fractional bits) and fixedFromXyz (12 fractional bits) convert between
+    // linear RGB and XYZ divided by the white point.
+    static const s32 FIXED_ONE = 1 << 15;
+    static const s32 FIXED_STEP_BITS = 3;
+    static const s32 FIXED_STEPS = FIXED_ONE >> FIXED_STEP_BITS;
+    s32 fixedLinear[256];
+    s32 fixedEncode[FIXED_STEPS + 2];
+    s32 fixedCubeRoot[FIXED_STEPS + 2];
+    s32 fixedToXyz[9];
+    s32 fixedFromXyz[9];
+
+    static const FastColorTables& instance() {
+      static const FastColorTables tables;
+      return tables;
+    }
+
+  private:
+    FastColorTables() {
+      for (u32 i = 0; i < 255 * LINEAR_STEPS + 2; i++)
+        linear[i] = linearizeSrgb((double)i / LINEAR_STEPS / 255.0);
+      for (u32 k = 0; k < 255; k++)
+        encodeThreshold[k] = linearizeSrgb((k + 0.5) / 255.0);
+
+      for (u32 v = 0; v < 256; v++)
+        fixedLinear[v] = (s32)round(linearizeSrgb(v / 255.0) * FIXED_ONE);
+      for (s32 i = 0; i < FIXED_STEPS + 2; i++) {
+        const double t = std::min((double)i / FIXED_STEPS, 1.0);
+        const double encoded = (t > 0.0031308) ? (1.055 * pow(t, 1.0 / 2.4)) - 0.055 : t * 12.92;
+        fixedEncode[i] = (s32)round(encoded * 255 * 256);
+        fixedCubeRoot[i] = (s32)round(((t > 0.008856) ? cbrt(t) : (7.787 * t) + (16.0 / 116.0)) * FIXED_ONE);
+      }
+      const double toXyz[9] = {0.4124 / 0.95047,  0.3576 / 0.95047,  0.1805 / 0.95047,
+                               0.2126,            0.7152,            0.0722,
+                               0.0193 / 1.08883,  0.1192 / 1.08883,  0.9505 / 1.08883};
+      const double fromXyz[9] = { 3.2406 * 0.95047, -1.5372, -0.4986 * 1.08883,
+                                 -0.9689 * 0.95047,  1.8758,  0.0415 * 1.08883,
+                                  0.0557 * 0.95047, -0.2040,  1.0570 * 1.08883};
+      for (u32 k = 0; k < 9; k++) {
+        fixedToXyz[k] = (s32)round(toXyz[k] * (1 << 14));
+        fixedFromXyz[k] = (s32)round(fromXyz[k] * (1 << 12));
+      }
+    }
+
+    static double linearizeSrgb(const double c) {
+      return (c > 0.04045) ? pow((c + 0.055) / 1.055, 2.4) : c / 12.92;
+    }
+};
+
+// Linear RGB value (0 - 1) of an sRGB value (0 - 255).
+SENSE_FORCE_INLINE double linearizeSrgbFast(const FastColorTables& tables, const double value) {
+  if (!(value >= 0 && value <= 255)) {
+    const double c = value / 255.0;
+    return (c > 0.04045) ? pow((c + 0.055) / 1.055, 2.4) : c / 12.92;
+  }
+  const double t = value * FastColorTables::LINEAR_STEPS;
+  const u32 i = (u32)t;
+  return tables.linear[i] + (t - i) * (tables.linear[i + 1] - tables.linear[i]);
+}
+
+// Rounded sRGB value (0 - 255) of a linear RGB value (0 - 1).
+SENSE_FORCE_INLINE double encodeSrgbFast(const FastColorTables& tables, const double c) {
+  if (!(c >= 0 && c <= 1))
+    return round(((c > 0.0031308) ? (1.055 * pow(c, 1.0 / 2.4)) - 0.055 : c * 12.92) * 255);
+
+  // Branch-free binary search over the 255 rounding thresholds.
+  u32 k = 0;
+  for (u32 step = 128; step > 0; step >>= 1)
+    k += (c >= tables.encodeThreshold[k + step - 1]) ? step : 0;
+  return k;
+}
+
+// Cube root of a positive number: an estimate taken from the exponent bits
+// (within a few percent) refined by two Halley iterations (relative error
+// below 1e-14).
+SENSE_FORCE_INLINE double cubeRootFast(const double x) {
+  u64 bits;
+  memcpy(&bits, &x, sizeof(bits));
+  bits = bits / 3 + 0x2A9F7893782DA1CEULL;
+  double y;
+  memcpy(&y, &bits, sizeof(y));
+  for (u32 i = 0; i < 2; i++) {
+    const double y3 = y * y * y;
+    y = y * (y3 + 2.0 * x) / (2.0 * y3 + x);
+  }
+  return y;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel functions for XYZ and L*a*b*.
+////////////////////////////////////////////////////////////////////////////////
+
+// Conversions of a single pixel between RGB, XYZ and L*a*b*. The kernels
+// chain them per pixel, so that conversions through XYZ keep the
+// intermediate values in registers instead of in planes. Functions ending in
+// Fast implement CONVERSION_FAST.
+
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToXyzPixel(const eT rIn, const eT gIn, const eT bIn, eT& xOut, eT& yOut, eT& zOut) {
+  eT r = rIn / 255.0;
+  eT g = gIn / 255.0;
+  eT b = bIn / 255.0;
+
+  if(r > 0.04045) { r = powf(((r+0.055)/1.055),2.4); }
+  else            { r = r/12.92;                     }
+
+  if(g > 0.04045) { g = powf(((g+0.055)/1.055),2.4); }
+  else            { g = g/12.92;                     }
+
+  if(b > 0.04045) { b = powf(((b+0.055)/1.055),2.4); }
+  else            { b = b/12.92;                     }
+
+  xOut = (r * 0.4124 * 100.0) + (g * 0.3576 * 100.0) + (b * 0.1805 * 100.0);
+  yOut = (r * 0.2126 * 100.0) + (g * 0.7152 * 100.0) + (b * 0.0722 * 100.0);
+  zOut = (r * 0.0193 * 100.0) + (g * 0.1192 * 100.0) + (b * 0.9505 * 100.0);
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToXyzPixelFast(const FastColorTables& tables,
+                              const eT rIn, const eT gIn, const eT bIn, eT& xOut, eT& yOut, eT& zOut) {
+  const double r = linearizeSrgbFast(tables, rIn);
+  const double g = linearizeSrgbFast(tables, gIn);
+  const double b = linearizeSrgbFast(tables, bIn);
+
+  xOut = (r * 0.4124 * 100.0) + (g * 0.3576 * 100.0) + (b * 0.1805 * 100.0);
+  yOut = (r * 0.2126 * 100.0) + (g * 0.7152 * 100.0) + (b * 0.0722 * 100.0);
+  zOut = (r * 0.0193 * 100.0) + (g * 0.1192 * 100.0) + (b * 0.9505 * 100.0);
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void xyzToLabPixel(const eT xIn, const eT yIn, const eT zIn, eT& lOut, eT& aOut, eT& bOut) {
+  eT x = xIn / 95.047;
+  eT y = yIn / 100;
+  eT z = zIn / 108.883;
+
+  if ( x > 0.008856 ) { x = pow(x, (1.0/3.0));                }
+  else                { x = ( 7.787 * x ) + ( 16.0 / 116.0 ); }
+
+  if ( y > 0.008856 ) { y = pow(y, ( 1.0/3.0 ));              }
+  else                { y = ( 7.787 * y ) + ( 16.0 / 116.0 ); }
+
+  if ( z > 0.008856 ) { z = pow(z, ( 1.0/3.0 ));              }
+  else                { z = ( 7.787 * z ) + ( 16.0 / 116.0 ); }
+
+  lOut = ( 116 * y ) - 16;
+  aOut = 500 * ( x - y );
+  bOut = 200 * ( y - z );
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void xyzToLabPixelFast(const eT xIn, const eT yIn, const eT zIn, eT& lOut, eT& aOut, eT& bOut) {
+  eT x = xIn / 95.047;
+  eT y = yIn / 100;
+  eT z = zIn / 108.883;
+
+  x = ( x > 0.008856 ) ? cubeRootFast(x) : ( 7.787 * x ) + ( 16.0 / 116.0 );
+  y = ( y > 0.008856 ) ? cubeRootFast(y) : ( 7.787 * y ) + ( 16.0 / 116.0 );
+  z = ( z > 0.008856 ) ? cubeRootFast(z) : ( 7.787 * z ) + ( 16.0 / 116.0 );
+
+  lOut = ( 116 * y ) - 16;
+  aOut = 500 * ( x - y );
+  bOut = 200 * ( y - z );
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void xyzToRgbPixel(const eT xIn, const eT yIn, const eT zIn, eT& rOut, eT& gOut, eT& bOut) {
+  eT x = xIn / 100.00;
+  eT y = yIn / 100.00;
+  eT z = zIn / 100.00;
+
+  eT r = ( x * ( 3.2406)) + ( y * (-1.5372)) + ( z * (-0.4986));
+  eT g = ( x * (-0.9689)) + ( y * ( 1.8758)) + ( z * ( 0.0415));
+  eT b = ( x * ( 0.0557)) + ( y * (-0.2040)) + ( z * ( 1.0570));
+
+  if(r > 0.0031308) { r = ((1.055 * (pow(r, 1.0/2.4))) - 0.055); }
+  else              { r = r * 12.92;                             }
+
+  if(g > 0.0031308) { g = ((1.055 * (pow(g, 1.0/2.4))) - 0.055); }
+  else              { g = g * 12.92;                             }
+
+  if(b > 0.0031308) { b = ((1.055 * (pow(b, 1.0/2.4))) - 0.055); }
+  else              { b = b * 12.92;                             }
+
+  rOut = round(r * 255);  // Convert XYZ to R
+  gOut = round(g * 255);  // Convert XYZ to G
+  bOut = round(b * 255);  // Convert XYZ to B
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void xyzToRgbPixelFast(const FastColorTables& tables,
+                              const eT xIn, const eT yIn, const eT zIn, eT& rOut, eT& gOut, eT& bOut) {
+  eT x = xIn / 100.00;
+  eT y = yIn / 100.00;
+  eT z = zIn / 100.00;
+
+  eT r = ( x * ( 3.2406)) + ( y * (-1.5372)) + ( z * (-0.4986));
+  eT g = ( x * (-0.9689)) + ( y * ( 1.8758)) + ( z * ( 0.0415));
+  eT b = ( x * ( 0.0557)) + ( y * (-0.2040)) + ( z * ( 1.0570));
+
+  rOut = encodeSrgbFast(tables, r);
+  gOut = encodeSrgbFast(tables, g);
+  bOut = encodeSrgbFast(tables, b);
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void labToXyzPixel(const eT lIn, const eT aIn, const eT bIn, eT& xOut, eT& yOut, eT& zOut) {
+  eT y = ((lIn + 16.0) / 116.0);
+  eT x = ((aIn / 500.0) + y);
+  eT z = (y - (bIn / 200.0));
+
+  if ( pow(y, 3.0) > 0.008856 ) { y = pow(y, 3.0);                  }
+  else                          { y = ( y - 16.0 / 116.0 ) / 7.787; }
+  if ( pow(x, 3.0) > 0.008856 ) { x = pow(x, 3.0);                  }
+  else                          { x = ( x - 16.0 / 116.0 ) / 7.787; }
+  if ( pow(z, 3.0) > 0.008856 ) { z = pow(z, 3.0);                  }
+  else                          { z = ( z - 16.0 / 116.0 ) / 7.787; }
+
+  xOut = x * 95.047;
+  yOut = y * 100.000;
+  zOut = z * 108.883;
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void labToXyzPixelFast(const eT lIn, const eT aIn, const eT bIn, eT& xOut, eT& yOut, eT& zOut) {
+  eT y = ((lIn + 16.0) / 116.0);
+  eT x = ((aIn / 500.0) + y);
+  eT z = (y - (bIn / 200.0));
+
+  const eT y3 = y * y * y;
+  const eT x3 = x * x * x;
+  const eT z3 = z * z * z;
+
+  y = (y3 > 0.008856) ? y3 : ( y - 16.0 / 116.0 ) / 7.787;
+  x = (x3 > 0.008856) ? x3 : ( x - 16.0 / 116.0 ) / 7.787;
+  z = (z3 > 0.008856) ? z3 : ( z - 16.0 / 116.0 ) / 7.787;
+
+  xOut = x * 95.047;
+  yOut = y * 100.000;
+  zOut = z * 108.883;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel functions for other color spaces.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+SENSE_FORCE_INLINE void normalizedRgbToRgbPixel(const eT normalizedRIn, const eT normalizedGIn, const eT normalizedBIn,
+                                    eT& rOut, eT& gOut, eT& bOut) {
+  rOut = normalizedRIn;
+  gOut = normalizedGIn;
+  bOut = normalizedBIn;
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToNormalizedRgbPixel(const eT r, const eT g, const eT b,
+                                    eT& normalizedROut, eT& normalizedGOut, eT& normalizedBOut) {
+  eT sum          = r + g + b;
+  eT normalizedR  = (r * 255 / sum);
+  eT normalizedG  = (g * 255 / sum);
+  eT normalizedB  = (b * 255 / sum);
+
+  normalizedROut = normalizedR;
+  normalizedGOut = normalizedG;
+  normalizedBOut = normalizedB;
+}
+
+// HSV pixels are converted without branches: every case is computed and the
+// result is selected, so that the kernels vectorize.
+
+template<typename eT>
+SENSE_FORCE_INLINE void hsvToRgbPixel(const eT h, const eT s, const eT v, eT& rOut, eT& gOut, eT& bOut) {
+  eT var_h = h * 6.0;
+  var_h = ( var_h == 6 ) ? 0 : var_h;   // H must be < 1
+  const eT var_i = int( var_h );        // Or ... var_i = floor( var_h )
+  const eT var_1 = v * ( 1.0 - s );
+  const eT var_2 = v * ( 1.0 - s * ( var_h - var_i ) );
+  const eT var_3 = v * ( 1.0 - s * ( 1.0 - ( var_h - var_i ) ) );
+
+  //   var_i:  0      1      2      3      4      other
+  //   R:      v      var_2  var_1  var_1  var_3  v
+  //   G:      var_3  v      v      var_2  var_1  var_1
+  //   B:      var_1  var_1  var_3  v      v      var_2
+  eT r = v;
+  eT g = var_1;
+  eT b = var_2;
+  r = ( var_i == 1 ) ? var_2 : r;
+  r = ( var_i == 2 ) ? var_1 : r;
+  r = ( var_i == 3 ) ? var_1 : r;
+  r = ( var_i == 4 ) ? var_3 : r;
+  g = ( var_i == 0 ) ? var_3 : g;
+  g = ( var_i == 1 ) ? v     : g;
+  g = ( var_i == 2 ) ? v     : g;
+  g = ( var_i == 3 ) ? var_2 : g;
+  b = ( var_i == 0 ) ? var_1 : b;
+  b = ( var_i == 1 ) ? var_1 : b;
+  b = ( var_i == 2 ) ? var_3 : b;
+  b = ( var_i == 3 ) ? v     : b;
+  b = ( var_i == 4 ) ? v     : b;
+
+  const bool gray = ( s == 0 );         // HSV from 0 to 1
+  rOut = gray ? (eT)(v * 255.0) : (eT)(r * 255);
+  gOut = gray ? (eT)(v * 255.0) : (eT)(g * 255);
+  bOut = gray ? (eT)(v * 255.0) : (eT)(b * 255);
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToHsvPixel(const eT rIn, const eT gIn, const eT bIn, eT& hOut, eT& sOut, eT& vOut) {
+  eT r = rIn / 255.0;
+  eT g = gIn / 255.0;
+  eT b = bIn / 255.0;
+
+  const eT min = std::min(r, std::min(g, b));
+  const eT max = std::max(r, std::max(g, b));
+  eT del_Max   = max - min;
+
+  const eT del_R = ( ( ( max - r ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
+  const eT del_G = ( ( ( max - g ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
+  const eT del_B = ( ( ( max - b ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
+
+  // Selected in reverse order, so that R takes precedence over G and G over B.
+  eT h = 0;
+  h = ( b == max ) ? ( 2.0 / 3.0 ) + del_G - del_R : h;
+  h = ( g == max ) ? ( 1.0 / 3.0 ) + del_R - del_B : h;
+  h = ( r == max ) ? del_B - del_G                 : h;
+  h = ( h < 0 ) ? h + 1 : h;
+  h = ( h > 1 ) ? h - 1 : h;
+
+  const bool gray = ( del_Max == 0 );   // This is a gray, no chroma
+  vOut = max;
+  hOut = gray ? 0 : h;                  // HSV results from 0 to 1
+  sOut = gray ? 0 : del_Max / max;
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void yCbCrToRgbPixel(const eT y, const eT cb, const eT cr, eT& rOut, eT& gOut, eT& bOut) {
+  rOut = round( ((1.000 * y) + ( 0.000000 * cb) + (1.402000 * cr)) * 255 );
+  gOut = round( ((1.000 * y) + (-0.344136 * cb) - (0.714136 * cr)) * 255 );
+  bOut = round( ((1.000 * y) + ( 1.772000 * cb) + (0.000000 * cr)) * 255 );
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToYCbCrPixel(const eT rIn, const eT gIn, const eT bIn, eT& yOut, eT& cbOut, eT& crOut) {
+  eT r = rIn / 255;
+  eT g = gIn / 255;
+  eT b = bIn / 255;
+
+  yOut  = ( ( ( ( 0.299000 * r) + ( 0.587000 * g )  + ( 0.114000 * b) )  ) );
+  cbOut = ( ( ( (-0.168736 * r) + (-0.331264 * g )  + ( 0.500000 * b) )  ) );
+  crOut = ( ( ( ( 0.500000 * r) + (-0.418688 * g )  + (-0.081312 * b) )  ) );
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE eT rgbToGrayPixel(const eT r, const eT g, const eT b) {
+  return 0.2126*r + 0.7152*g + 0.0722*b;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pixel functions for integer images.
 ////////////////////////////////////////////////////////////////////////////////
 
+// Images with integer elements are converted in fixed point, with every
+// channel rounded to 0 - 255 as described in image.h. Right shifts of
+// negative values are assumed to be arithmetic, as with every supported
+// compiler.
+
+SENSE_FORCE_INLINE s32 clampByte(const s32 value) {
+  return std::min(std::max(value, 0), 255);
+}
+
+// Value of a table sampled like fixedEncode at t (clamped to 0 - FIXED_ONE),
+// interpolated linearly.
+SENSE_FORCE_INLINE s32 lookupFixed(const s32* table, const s32 t) {
+  const s32 bits = FastColorTables::FIXED_STEP_BITS;
+  const s32 tc = std::min(std::max(t, 0), FastColorTables::FIXED_ONE);
+  const s32 i = tc >> bits;
+  const s32 frac = tc & ((1 << bits) - 1);
+  return table[i] + (((table[i + 1] - table[i]) * frac + (1 << (bits - 1))) >> bits);
+}
+
+// Conversions between 0 - 255 values and fixed-point values (0 - FIXED_ONE).
+template<typename eT>
+SENSE_FORCE_INLINE s32 valueToFixed(const eT value) {
+  return (clampByte((s32)value) * 32897 + 128) >> 8;  // 32897 = 256 * FIXED_ONE / 255
+}
+
+SENSE_FORCE_INLINE s32 fixedToValue(const s32 value) {
+  return clampByte((value * 255 + (FastColorTables::FIXED_ONE >> 1)) >> 15);
+}
+
+// RGB to XYZ divided by the white point, in fixed point.
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToXyzFixed(const FastColorTables& tables,
+                                      const eT rIn, const eT gIn, const eT bIn, s32& x, s32& y, s32& z) {
+  const s32* m = tables.fixedToXyz;
+  const s32 r = tables.fixedLinear[clampByte((s32)rIn)];
+  const s32 g = tables.fixedLinear[clampByte((s32)gIn)];
+  const s32 b = tables.fixedLinear[clampByte((s32)bIn)];
+
+  x = (m[0] * r + m[1] * g + m[2] * b + (1 << 13)) >> 14;
+  y = (m[3] * r + m[4] * g + m[5] * b + (1 << 13)) >> 14;
+  z = (m[6] * r + m[7] * g + m[8] * b + (1 << 13)) >> 14;
+}
+
+template<typename eT>
+SENSE_FORCE_INLINE void xyzFixedToRgb(const FastColorTables& tables,
+                                      const s32 xIn, const s32 yIn, const s32 zIn, eT& rOut, eT& gOut, eT& bOut) {
+  const s32* m = tables.fixedFromXyz;
+  const s32 x = std::min(std::max(xIn, 0), 2 * FastColorTables::FIXED_ONE);
+  const s32 y = std::min(std::max(yIn, 0), 2 * FastColorTables::FIXED_ONE);
+  const s32 z = std::min(std::max(zIn, 0), 2 * FastColorTables::FIXED_ONE);
+
+  const s32 r = (m[0] * x + m[1] * y + m[2] * z + (1 << 11)) >> 12;
+  const s32 g = (m[3] * x + m[4] * y + m[5] * z + (1 << 11)) >> 12;
+  const s32 b = (m[6] * x + m[7] * y + m[8] * z + (1 << 11)) >> 12;
+
+  rOut = (lookupFixed(tables.fixedEncode, r) + 128) >> 8;
+  gOut = (lookupFixed(tables.fixedEncode, g) + 128) >> 8;
+  bOut = (lookupFixed(tables.fixedEncode, b) + 128) >> 8;
+}
+
+// XYZ divided by the white point, in fixed point, to L*a*b*: L* times 2.55,
+// a* and b* plus 128.
+template<typename eT>
+SENSE_FORCE_INLINE void xyzFixedToLab(const FastColorTables& tables,
+                                      const s32 x, const s32 y, const s32 z, eT& lOut, eT& aOut, eT& bOut) {
+  const s32 fx = lookupFixed(tables.fixedCubeRoot, x);
+  const s32 fy = lookupFixed(tables.fixedCubeRoot, y);
+  const s32 fz = lookupFixed(tables.fixedCubeRoot, z);
+
+  lOut = clampByte((fy * 37862 - 171127603 + (1 << 21)) >> 22);  // 2.55 * (116 * fy - 16), 22 fractional bits
+  aOut = clampByte((500 * (fx - fy) + (128 << 15) + (1 << 14)) >> 15);
+  bOut = clampByte((200 * (fy - fz) + (128 << 15) + (1 << 14)) >> 15);
+}
+
+// Inverse of the L*a*b* function f, in fixed point.
+SENSE_FORCE_INLINE s32 labInverseFixed(const s32 t) {
+  const u32 tc = (u32)std::min(std::max(t, 0), 41285);  // Cube root of 2
+  const s32 cube = (s32)((((tc * tc) >> 15) * tc) >> 15);
+  const s32 linear = ((t - 4520) * 526 + (1 << 11)) >> 12;  // (t - 16 / 116) / 7.787
+  return (t > 6779) ? cube : linear;  // t > 6 / 29
+}
+
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageNormalizedRGB<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+SENSE_FORCE_INLINE void labToXyzFixed(const eT lIn, const eT aIn, const eT bIn, s32& x, s32& y, s32& z) {
+  const s32 l = clampByte((s32)lIn);
+  const s32 a = clampByte((s32)aIn) - 128;
+  const s32 b = clampByte((s32)bIn) - 128;
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
+  // (L* + 16) / 116, and a* / 500 and b* / 200 added to it, with 7 more
+  // fractional bits.
+  const s32 fy = l * 14180 + 578525;
+  x = labInverseFixed((fy + a * 8389 + 64) >> 7);
+  y = labInverseFixed((fy + 64) >> 7);
+  z = labInverseFixed((fy - b * 20972 + 64) >> 7);
+}
 
-  imageOut.setSize(height, width);
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToNormalizedRgbPixelFixed(const eT rIn, const eT gIn, const eT bIn,
+                                                     eT& normalizedROut, eT& normalizedGOut, eT& normalizedBOut) {
+  const s32 r = rIn;
+  const s32 g = gIn;
+  const s32 b = bIn;
+  const s32 sum = std::max(r + g + b, 1);  // Black stays black
 
-  imageOut.r = imageIn.normalizedR;
-  imageOut.g = imageIn.normalizedG;
-  imageOut.b = imageIn.normalizedB;
+  normalizedROut = (r * 255 + sum / 2) / sum;
+  normalizedGOut = (g * 255 + sum / 2) / sum;
+  normalizedBOut = (b * 255 + sum / 2) / sum;
 }
 
+// H, S and V times 255.
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageXYZ<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+SENSE_FORCE_INLINE void hsvToRgbPixelFixed(const eT hIn, const eT sIn, const eT vIn, eT& rOut, eT& gOut, eT& bOut) {
+  const s32 s = clampByte((s32)sIn);
+  const s32 v = clampByte((s32)vIn);
+  s32 var_h = clampByte((s32)hIn) * 6;  // Sixths of the hue circle, times 255
+  var_h = ( var_h == 6 * 255 ) ? 0 : var_h;
+  const s32 var_i = var_h / 255;
+  const s32 var_f = var_h - var_i * 255;
+  const s32 var_1 = ( v * ( 255 - s ) + 127 ) / 255;
+  const s32 var_2 = ( v * ( 255 * 255 - s * var_f ) + 32512 ) / ( 255 * 255 );
+  const s32 var_3 = ( v * ( 255 * 255 - s * ( 255 - var_f ) ) + 32512 ) / ( 255 * 255 );
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+  // As in hsvToRgbPixel. Gray (s = 0) needs no special case: every var is v.
+  s32 r = v;
+  s32 g = var_1;
+  s32 b = var_2;
+  r = ( var_i == 1 ) ? var_2 : r;
+  r = ( var_i == 2 ) ? var_1 : r;
+  r = ( var_i == 3 ) ? var_1 : r;
+  r = ( var_i == 4 ) ? var_3 : r;
+  g = ( var_i == 0 ) ? var_3 : g;
+  g = ( var_i == 1 ) ? v     : g;
+  g = ( var_i == 2 ) ? v     : g;
+  g = ( var_i == 3 ) ? var_2 : g;
+  b = ( var_i == 0 ) ? var_1 : b;
+  b = ( var_i == 1 ) ? var_1 : b;
+  b = ( var_i == 2 ) ? var_3 : b;
+  b = ( var_i == 3 ) ? v     : b;
+  b = ( var_i == 4 ) ? v     : b;
 
-  imageOut.setSize(height, width);
+  rOut = r;
+  gOut = g;
+  bOut = b;
+}
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT x = imageIn.x(i) / 100.00;
-    eT y = imageIn.y(i) / 100.00;
-    eT z = imageIn.z(i) / 100.00;
+template<typename eT>
+SENSE_FORCE_INLINE void rgbToHsvPixelFixed(const eT rIn, const eT gIn, const eT bIn, eT& hOut, eT& sOut, eT& vOut) {
+  const s32 r = clampByte((s32)rIn);
+  const s32 g = clampByte((s32)gIn);
+  const s32 b = clampByte((s32)bIn);
 
-    eT r = ( x * ( 3.2406)) + ( y * (-1.5372)) + ( z * (-0.4986));
-    eT g = ( x * (-0.9689)) + ( y * ( 1.8758)) + ( z * ( 0.0415));
-    eT b = ( x * ( 0.0557)) + ( y * (-0.2040)) + ( z * ( 1.0570));
+  const s32 min = std::min(r, std::min(g, b));
+  const s32 max = std::max(r, std::max(g, b));
+  const s32 del_Max = max - min;
 
-    if(r > 0.0031308) { r = ((1.055 * (pow(r, 1.0/2.4))) - 0.055); }
-    else              { r = r * 12.92;                             }
+  // Hue in sixths of the circle times del_Max, from 0 to 6 * del_Max.
+  s32 h = ( 4 * del_Max ) + r - g;
+  h = ( g == max ) ? ( 2 * del_Max ) + b - r : h;
+  h = ( r == max ) ? g - b                   : h;
+  h = ( h < 0 ) ? h + ( 6 * del_Max ) : h;
 
-    if(g > 0.0031308) { g = ((1.055 * (pow(g, 1.0/2.4))) - 0.055); }
-    else              { g = g * 12.92;                             }
+  // Gray pixels get h = 0 and s = 0 without a division by zero.
+  const s32 hDivisor = 6 * std::max(del_Max, 1);
+  vOut = max;
+  hOut = ( 255 * h + hDivisor / 2 ) / hDivisor;
+  sOut = ( 255 * del_Max + max / 2 ) / std::max(max, 1);
+}
 
-    if(b > 0.0031308) { b = ((1.055 * (pow(b, 1.0/2.4))) - 0.055); }
-    else              { b = b * 12.92;                             }
+// Full-range BT.601 Y'CbCr: Y' times 255, Cb and Cr times 255 plus 128.
+template<typename eT>
+SENSE_FORCE_INLINE void yCbCrToRgbPixelFixed(const eT yIn, const eT cbIn, const eT crIn, eT& rOut, eT& gOut, eT& bOut) {
+  const s32 y = clampByte((s32)yIn) << 16;
+  const s32 cb = clampByte((s32)cbIn) - 128;
+  const s32 cr = clampByte((s32)crIn) - 128;
 
-    imageOut.r(i) = round(r * 255);  // Convert XYZ to R
-    imageOut.g(i) = round(g * 255);  // Convert XYZ to G
-    imageOut.b(i) = round(b * 255);  // Convert XYZ to B
-  }
+  rOut = clampByte((y                + 91881 * cr + (1 << 15)) >> 16);
+  gOut = clampByte((y - 22554 * cb  - 46802 * cr + (1 << 15)) >> 16);
+  bOut = clampByte((y + 116130 * cb              + (1 << 15)) >> 16);
 }
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageLAB<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+SENSE_FORCE_INLINE void rgbToYCbCrPixelFixed(const eT rIn, const eT gIn, const eT bIn, eT& yOut, eT& cbOut, eT& crOut) {
+  const s32 r = clampByte((s32)rIn);
+  const s32 g = clampByte((s32)gIn);
+  const s32 b = clampByte((s32)bIn);
+
+  yOut  = ( 19595 * r + 38470 * g +  7471 * b + (1 << 15)) >> 16;
+  cbOut = clampByte((-11058 * r - 21710 * g + 32768 * b + (128 << 16) + (1 << 15)) >> 16);
+  crOut = clampByte(( 32768 * r - 27439 * g -  5329 * b + (128 << 16) + (1 << 15)) >> 16);
+}
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT>
+SENSE_FORCE_INLINE eT rgbToGrayPixelFixed(const eT r, const eT g, const eT b) {
+  return (13933 * clampByte((s32)r) + 46871 * clampByte((s32)g) + 4732 * clampByte((s32)b) + (1 << 15)) >> 16;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Color spaces.
+////////////////////////////////////////////////////////////////////////////////
 
-  ImageXYZ<eT> imageXyz(height, width);
+// Every color space converts a single pixel from and to RGB. The template
+// parameter fast selects the CONVERSION_FAST variant of floating-point
+// pixels; integer pixels always use the fixed-point functions above. tables
+// is only used in these two cases. Chaining toRgb() of one space with fromRgb() of another
+// gives a direct conversion between them whose RGB intermediate stays in
+// registers, with the same result as converting through an ImageRGB.
+
+struct RGBSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables*, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    r = c0;
+    g = c1;
+    b = c2;
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables*, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    c0 = r;
+    c1 = g;
+    c2 = b;
+  }
+};
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT y = ((imageIn.l(i) + 16.0) / 116.0);
-    eT x = ((imageIn.a(i) / 500.0) + y);
-    eT z = (y - (imageIn.b(i) / 200.0));
+struct NormalizedRGBSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables*, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    normalizedRgbToRgbPixel(c0, c1, c2, r, g, b);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables*, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) rgbToNormalizedRgbPixelFixed(r, g, b, c0, c1, c2);
+    else                        rgbToNormalizedRgbPixel(r, g, b, c0, c1, c2);
+  }
+};
+
+struct XYZSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables* tables, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    if (is_integral<eT>::value) xyzFixedToRgb(*tables, valueToFixed(c0), valueToFixed(c1), valueToFixed(c2), r, g, b);
+    else if (fast)              xyzToRgbPixelFast(*tables, c0, c1, c2, r, g, b);
+    else                        xyzToRgbPixel(c0, c1, c2, r, g, b);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables* tables, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) {
+      s32 x, y, z;
+      rgbToXyzFixed(*tables, r, g, b, x, y, z);
+      c0 = fixedToValue(x);
+      c1 = fixedToValue(y);
+      c2 = fixedToValue(z);
+    }
+    else if (fast) rgbToXyzPixelFast(*tables, r, g, b, c0, c1, c2);
+    else           rgbToXyzPixel(r, g, b, c0, c1, c2);
+  }
+};
+
+struct LABSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toXyz(const FastColorTables*, const eT c0, const eT c1, const eT c2, eT& x, eT& y, eT& z) {
+    if (is_integral<eT>::value) {
+      s32 xFixed, yFixed, zFixed;
+      labToXyzFixed(c0, c1, c2, xFixed, yFixed, zFixed);
+      x = fixedToValue(xFixed);
+      y = fixedToValue(yFixed);
+      z = fixedToValue(zFixed);
+    }
+    else if (fast) labToXyzPixelFast(c0, c1, c2, x, y, z);
+    else           labToXyzPixel(c0, c1, c2, x, y, z);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromXyz(const FastColorTables* tables, const eT x, const eT y, const eT z, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) xyzFixedToLab(*tables, valueToFixed(x), valueToFixed(y), valueToFixed(z), c0, c1, c2);
+    else if (fast)              xyzToLabPixelFast(x, y, z, c0, c1, c2);
+    else                        xyzToLabPixel(x, y, z, c0, c1, c2);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables* tables, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    if (is_integral<eT>::value) {
+      // Keep XYZ in fixed point rather than rounding it to 0 - 255.
+      s32 x, y, z;
+      labToXyzFixed(c0, c1, c2, x, y, z);
+      xyzFixedToRgb(*tables, x, y, z, r, g, b);
+      return;
+    }
+    eT x, y, z;
+    toXyz<fast>(tables, c0, c1, c2, x, y, z);  // Convert L*a*b* to XYZ
+    XYZSpace::toRgb<fast>(tables, x, y, z, r, g, b);  // Convert XYZ to RGB
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables* tables, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) {
+      s32 x, y, z;
+      rgbToXyzFixed(*tables, r, g, b, x, y, z);
+      xyzFixedToLab(*tables, x, y, z, c0, c1, c2);
+      return;
+    }
+    eT x, y, z;
+    XYZSpace::fromRgb<fast>(tables, r, g, b, x, y, z);  // Convert RGB to XYZ
+    fromXyz<fast>(tables, x, y, z, c0, c1, c2);  // Convert XYZ to L*a*b*
+  }
+};
 
-    if ( pow(y, 3.0) > 0.008856 ) { y = pow(y, 3.0);                  }
-    else                          { y = ( y - 16.0 / 116.0 ) / 7.787; }
-    if ( pow(x, 3.0) > 0.008856 ) { x = pow(x, 3.0);                  }
-    else                          { x = ( x - 16.0 / 116.0 ) / 7.787; }
-    if ( pow(z, 3.0) > 0.008856 ) { z = pow(z, 3.0);                  }
-    else                          { z = ( z - 16.0 / 116.0 ) / 7.787; }
+struct HSVSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables*, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    if (is_integral<eT>::value) hsvToRgbPixelFixed(c0, c1, c2, r, g, b);
+    else                        hsvToRgbPixel(c0, c1, c2, r, g, b);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables*, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) rgbToHsvPixelFixed(r, g, b, c0, c1, c2);
+    else                        rgbToHsvPixel(r, g, b, c0, c1, c2);
+  }
+};
 
-    imageXyz.x(i) = x * 95.047;
-    imageXyz.y(i) = y * 100.000;
-    imageXyz.z(i) = z * 108.883;
+struct YCbCrSpace {
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void toRgb(const FastColorTables*, const eT c0, const eT c1, const eT c2, eT& r, eT& g, eT& b) {
+    if (is_integral<eT>::value) yCbCrToRgbPixelFixed(c0, c1, c2, r, g, b);
+    else                        yCbCrToRgbPixel(c0, c1, c2, r, g, b);
+  }
+  template<bool fast, typename eT>
+  static SENSE_FORCE_INLINE void fromRgb(const FastColorTables*, const eT r, const eT g, const eT b, eT& c0, eT& c1, eT& c2) {
+    if (is_integral<eT>::value) rgbToYCbCrPixelFixed(r, g, b, c0, c1, c2);
+    else                        rgbToYCbCrPixel(r, g, b, c0, c1, c2);
   }
+};
 
-  convert(imageOut, imageXyz);  // Convert XYZ to RGB
-}
+////////////////////////////////////////////////////////////////////////////////
+// Pixel kernels.
+////////////////////////////////////////////////////////////////////////////////
+
+// Each kernel converts n consecutive pixels, given as one pointer per input
+// and output plane. Whole images are converted with a single call; regions of
+// interest with one call per column.
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageHSV<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+using PixelKernel = void (*)(const eT*, const eT*, const eT*, eT*, eT*, eT*, const uword);
+
+template<typename eT>
+using GrayToColorKernel = void (*)(const eT*, eT*, eT*, eT*, const uword);
+
+template<typename eT>
+using ColorToGrayKernel = void (*)(const eT*, const eT*, const eT*, eT*, const uword);
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT>
+void copyPixels(const eT* in0, const eT* in1, const eT* in2,
+                eT* out0, eT* out1, eT* out2, const uword n) {
+  if (out0 != in0) memmove(out0, in0, n * sizeof(eT));
+  if (out1 != in1) memmove(out1, in1, n * sizeof(eT));
+  if (out2 != in2) memmove(out2, in2, n * sizeof(eT));
+}
 
-  imageOut.setSize(height, width);
+// Tables used by the kernels of a pixel type and mode, or NULL.
+template<typename eT, bool fast>
+const FastColorTables* colorTables() {
+  return (fast || is_integral<eT>::value) ? &FastColorTables::instance() : NULL;
+}
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    const eT h = imageIn.h(i);
-    const eT s = imageIn.s(i);
-    const eT v = imageIn.v(i);
+// Kernels other than copyPixels are structs whose run() is compiled for
+// every instruction set by SimdKernel. The conversion lookup functions below
+// return the version selected for the CPU.
 
-    if ( s == 0 )                       // HSV from 0 to 1
+// Convert pixels of color space From to color space To in a single pass.
+template<typename eT, bool fast, class From, class To>
+struct ColorToColorPixels {
+  typedef PixelKernel<eT> Function;
+  static SENSE_FORCE_INLINE void run(const eT* in0, const eT* in1, const eT* in2,
+                                     eT* out0, eT* out1, eT* out2, const uword n) {
+    const FastColorTables* tables = colorTables<eT, fast>();
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
+    {
+      eT r, g, b;
+      From::template toRgb<fast>(tables, in0[i], in1[i], in2[i], r, g, b);
+      To::template fromRgb<fast>(tables, r, g, b, out0[i], out1[i], out2[i]);
+    }
+  }
+};
+
+// XYZ and L*a*b* are converted into each other directly, without rounding to
+// RGB on the way.
+template<typename eT, bool fast>
+struct XyzToLabPixels {
+  typedef PixelKernel<eT> Function;
+  static SENSE_FORCE_INLINE void run(const eT* xIn, const eT* yIn, const eT* zIn,
+                                     eT* lOut, eT* aOut, eT* bOut, const uword n) {
+    const FastColorTables* tables = colorTables<eT, fast>();
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
+      LABSpace::fromXyz<fast>(tables, xIn[i], yIn[i], zIn[i], lOut[i], aOut[i], bOut[i]);
+  }
+};
+
+template<typename eT, bool fast>
+struct LabToXyzPixels {
+  typedef PixelKernel<eT> Function;
+  static SENSE_FORCE_INLINE void run(const eT* lIn, const eT* aIn, const eT* bIn,
+                                     eT* xOut, eT* yOut, eT* zOut, const uword n) {
+    const FastColorTables* tables = colorTables<eT, fast>();
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
+      LABSpace::toXyz<fast>(tables, lIn[i], aIn[i], bIn[i], xOut[i], yOut[i], zOut[i]);
+  }
+};
+
+template<typename eT, bool fast, class To>
+struct GrayToColorPixels {
+  typedef GrayToColorKernel<eT> Function;
+  static SENSE_FORCE_INLINE void run(const eT* grayIn, eT* out0, eT* out1, eT* out2, const uword n) {
+    const FastColorTables* tables = colorTables<eT, fast>();
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
     {
-      imageOut.r(i) = v * 255.0;
-      imageOut.g(i) = v * 255.0;
-      imageOut.b(i) = v * 255.0;
+      // For converting grayscale image to color image, we assume that all of
+      // the R, G, B channels are set to the same values.
+      To::template fromRgb<fast>(tables, grayIn[i], grayIn[i], grayIn[i], out0[i], out1[i], out2[i]);
     }
-    else
+  }
+};
+
+template<typename eT, bool fast, class From>
+struct ColorToGrayPixels {
+  typedef ColorToGrayKernel<eT> Function;
+  static SENSE_FORCE_INLINE void run(const eT* in0, const eT* in1, const eT* in2, eT* grayOut, const uword n) {
+    const FastColorTables* tables = colorTables<eT, fast>();
+    SENSE_IVDEP
+    for (uword i = 0; i < n; i++)
     {
-      eT var_h = h * 6.0;
-      if ( var_h == 6 ) var_h = 0;      // H must be < 1
-      eT var_i = int( var_h );          // Or ... var_i = floor( var_h )
-      eT var_1 = v * ( 1.0 - s );
-      eT var_2 = v * ( 1.0 - s * ( var_h - var_i ) );
-      eT var_3 = v * ( 1.0 - s * ( 1.0 - ( var_h - var_i ) ) );
-
-      if      ( var_i == 0 ) { imageOut.r(i) = v     * 255 ; imageOut.g(i) = var_3 * 255 ; imageOut.b(i) = var_1 * 255 ; }
-      else if ( var_i == 1 ) { imageOut.r(i) = var_2 * 255 ; imageOut.g(i) = v     * 255 ; imageOut.b(i) = var_1 * 255 ; }
-      else if ( var_i == 2 ) { imageOut.r(i) = var_1 * 255 ; imageOut.g(i) = v     * 255 ; imageOut.b(i) = var_3 * 255 ; }
-      else if ( var_i == 3 ) { imageOut.r(i) = var_1 * 255 ; imageOut.g(i) = var_2 * 255 ; imageOut.b(i) = v     * 255 ; }
-      else if ( var_i == 4 ) { imageOut.r(i) = var_3 * 255 ; imageOut.g(i) = var_1 * 255 ; imageOut.b(i) = v     * 255 ; }
-      else                   { imageOut.r(i) = v     * 255 ; imageOut.g(i) = var_1 * 255 ; imageOut.b(i) = var_2 * 255 ; }
+      eT r, g, b;
+      From::template toRgb<fast>(tables, in0[i], in1[i], in2[i], r, g, b);
+      grayOut[i] = is_integral<eT>::value ? rgbToGrayPixelFixed(r, g, b) : rgbToGrayPixel(r, g, b);
     }
   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel lookup.
+////////////////////////////////////////////////////////////////////////////////
+
+// Every pair of color spaces gets its own kernel, so no conversion needs an
+// intermediate image. ConversionKernel picks the kernel of a pair known at
+// compile time; the functions taking ColorSpace values map run-time color
+// spaces to it.
+
+template<typename eT, bool fast, class From, class To>
+struct ConversionKernel {
+  static PixelKernel<eT> select() { return SimdKernel<ColorToColorPixels<eT, fast, From, To> >::select(); }
+};
+
+template<typename eT, bool fast, class Space>
+struct ConversionKernel<eT, fast, Space, Space> {
+  static PixelKernel<eT> select() { return &copyPixels<eT>; }
+};
+
+template<typename eT, bool fast>
+struct ConversionKernel<eT, fast, XYZSpace, LABSpace> {
+  static PixelKernel<eT> select() { return SimdKernel<XyzToLabPixels<eT, fast> >::select(); }
+};
+
+template<typename eT, bool fast>
+struct ConversionKernel<eT, fast, LABSpace, XYZSpace> {
+  static PixelKernel<eT> select() { return SimdKernel<LabToXyzPixels<eT, fast> >::select(); }
+};
+
+template<typename eT, class To, class From>
+PixelKernel<eT> conversionKernel(const ConversionMode mode) {
+  return useFastConversion(mode) ? ConversionKernel<eT, true, From, To>::select()
+                                 : ConversionKernel<eT, false, From, To>::select();
+}
+
+template<typename eT, class To>
+GrayToColorKernel<eT> grayToColorKernel(const ConversionMode mode) {
+  return useFastConversion(mode) ? SimdKernel<GrayToColorPixels<eT, true, To> >::select()
+                                 : SimdKernel<GrayToColorPixels<eT, false, To> >::select();
+}
+
+template<typename eT, class From>
+ColorToGrayKernel<eT> colorToGrayKernel(const ConversionMode mode) {
+  return useFastConversion(mode) ? SimdKernel<ColorToGrayPixels<eT, true, From> >::select()
+                                 : SimdKernel<ColorToGrayPixels<eT, false, From> >::select();
+}
+
+template<typename eT, bool fast, class From>
+PixelKernel<eT> conversionKernelFrom(const ColorSpace colorSpaceOut) {
+  switch (colorSpaceOut) {
+    case COLORSPACE_RGB:           return ConversionKernel<eT, fast, From, RGBSpace>::select();
+    case COLORSPACE_NORMALIZEDRGB: return ConversionKernel<eT, fast, From, NormalizedRGBSpace>::select();
+    case COLORSPACE_XYZ:           return ConversionKernel<eT, fast, From, XYZSpace>::select();
+    case COLORSPACE_LAB:           return ConversionKernel<eT, fast, From, LABSpace>::select();
+    case COLORSPACE_HSV:           return ConversionKernel<eT, fast, From, HSVSpace>::select();
+    case COLORSPACE_YCBCR:         return ConversionKernel<eT, fast, From, YCbCrSpace>::select();
+    default:                       throw logic_error("Unknown color space");
+  }
+}
+
+template<typename eT, bool fast>
+PixelKernel<eT> conversionKernel(const ColorSpace colorSpaceOut, const ColorSpace colorSpaceIn) {
+  switch (colorSpaceIn) {
+    case COLORSPACE_RGB:           return conversionKernelFrom<eT, fast, RGBSpace>(colorSpaceOut);
+    case COLORSPACE_NORMALIZEDRGB: return conversionKernelFrom<eT, fast, NormalizedRGBSpace>(colorSpaceOut);
+    case COLORSPACE_XYZ:           return conversionKernelFrom<eT, fast, XYZSpace>(colorSpaceOut);
+    case COLORSPACE_LAB:           return conversionKernelFrom<eT, fast, LABSpace>(colorSpaceOut);
+    case COLORSPACE_HSV:           return conversionKernelFrom<eT, fast, HSVSpace>(colorSpaceOut);
+    case COLORSPACE_YCBCR:         return conversionKernelFrom<eT, fast, YCbCrSpace>(colorSpaceOut);
+    default:                       throw logic_error("Unknown color space");
+  }
 }
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const ImageYCbCr<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+PixelKernel<eT> conversionKernel(const ColorSpace colorSpaceOut, const ColorSpace colorSpaceIn,
+                                 const ConversionMode mode) {
+  return useFastConversion(mode) ? conversionKernel<eT, true>(colorSpaceOut, colorSpaceIn)
+                                 : conversionKernel<eT, false>(colorSpaceOut, colorSpaceIn);
+}
+
+template<typename eT, bool fast>
+GrayToColorKernel<eT> grayToColorKernel(const ColorSpace colorSpaceOut) {
+  switch (colorSpaceOut) {
+    case COLORSPACE_RGB:           return SimdKernel<GrayToColorPixels<eT, fast, RGBSpace> >::select();
+    case COLORSPACE_NORMALIZEDRGB: return SimdKernel<GrayToColorPixels<eT, fast, NormalizedRGBSpace> >::select();
+    case COLORSPACE_XYZ:           return SimdKernel<GrayToColorPixels<eT, fast, XYZSpace> >::select();
+    case COLORSPACE_LAB:           return SimdKernel<GrayToColorPixels<eT, fast, LABSpace> >::select();
+    case COLORSPACE_HSV:           return SimdKernel<GrayToColorPixels<eT, fast, HSVSpace> >::select();
+    case COLORSPACE_YCBCR:         return SimdKernel<GrayToColorPixels<eT, fast, YCbCrSpace> >::select();
+    default:                       throw logic_error("Unknown color space");
+  }
+}
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT, bool fast>
+ColorToGrayKernel<eT> colorToGrayKernel(const ColorSpace colorSpaceIn) {
+  switch (colorSpaceIn) {
+    case COLORSPACE_RGB:           return SimdKernel<ColorToGrayPixels<eT, fast, RGBSpace> >::select();
+    case COLORSPACE_NORMALIZEDRGB: return SimdKernel<ColorToGrayPixels<eT, fast, NormalizedRGBSpace> >::select();
+    case COLORSPACE_XYZ:           return SimdKernel<ColorToGrayPixels<eT, fast, XYZSpace> >::select();
+    case COLORSPACE_LAB:           return SimdKernel<ColorToGrayPixels<eT, fast, LABSpace> >::select();
+    case COLORSPACE_HSV:           return SimdKernel<ColorToGrayPixels<eT, fast, HSVSpace> >::select();
+    case COLORSPACE_YCBCR:         return SimdKernel<ColorToGrayPixels<eT, fast, YCbCrSpace> >::select();
+    default:                       throw logic_error("Unknown color space");
+  }
+}
 
-  imageOut.setSize(height, width);
+////////////////////////////////////////////////////////////////////////////////
+// Planes of image of any color space.
+////////////////////////////////////////////////////////////////////////////////
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    const eT& y  = imageIn.y(i) ;
-    const eT& cb = imageIn.cb(i);
-    const eT& cr = imageIn.cr(i);
+// Planes of the image classes, found at compile time.
 
-    imageOut.r(i) = round( ((1.000 * y) + ( 0.000000 * cb) + (1.402000 * cr)) * 255 );
-    imageOut.g(i) = round( ((1.000 * y) + (-0.344136 * cb) - (0.714136 * cr)) * 255 );
-    imageOut.b(i) = round( ((1.000 * y) + ( 1.772000 * cb) + (0.000000 * cr)) * 255 );
-  }
+template<typename eT>
+void imagePlanes(ImageRGB<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.r; plane1 = &image.g; plane2 = &image.b;
 }
 
 template<typename eT>
-void convert(ImageRGB<eT>& imageOut, const Image<eT>& imageIn) {
-  switch (imageIn.colorSpace()) {
+void imagePlanes(ImageNormalizedRGB<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.normalizedR; plane1 = &image.normalizedG; plane2 = &image.normalizedB;
+}
+
+template<typename eT>
+void imagePlanes(ImageXYZ<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.x; plane1 = &image.y; plane2 = &image.z;
+}
+
+template<typename eT>
+void imagePlanes(ImageLAB<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.l; plane1 = &image.a; plane2 = &image.b;
+}
+
+template<typename eT>
+void imagePlanes(ImageHSV<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.h; plane1 = &image.s; plane2 = &image.v;
+}
+
+template<typename eT>
+void imagePlanes(ImageYCbCr<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  plane0 = &image.y; plane1 = &image.cb; plane2 = &image.cr;
+}
+
+// Planes of an image whose color space is known at run time.
+
+template<typename eT>
+void imagePlanes(Image<eT>& image, Mat<eT>*& plane0, Mat<eT>*& plane1, Mat<eT>*& plane2) {
+  switch (image.colorSpace()) {
     case COLORSPACE_RGB:
-      imageOut = static_cast<const ImageRGB<eT>&>(imageIn);
+      imagePlanes(static_cast<ImageRGB<eT>&>(image), plane0, plane1, plane2);
       break;
     case COLORSPACE_NORMALIZEDRGB:
-      convert(imageOut, static_cast<const ImageNormalizedRGB<eT>&>(imageIn));
+      imagePlanes(static_cast<ImageNormalizedRGB<eT>&>(image), plane0, plane1, plane2);
       break;
     case COLORSPACE_XYZ:
-      convert(imageOut, static_cast<const ImageXYZ<eT>&>(imageIn));
+      imagePlanes(static_cast<ImageXYZ<eT>&>(image), plane0, plane1, plane2);
       break;
     case COLORSPACE_LAB:
-      convert(imageOut, static_cast<const ImageLAB<eT>&>(imageIn));
+      imagePlanes(static_cast<ImageLAB<eT>&>(image), plane0, plane1, plane2);
       break;
     case COLORSPACE_HSV:
-      convert(imageOut, static_cast<const ImageHSV<eT>&>(imageIn));
+      imagePlanes(static_cast<ImageHSV<eT>&>(image), plane0, plane1, plane2);
       break;
     case COLORSPACE_YCBCR:
-      convert(imageOut, static_cast<const ImageYCbCr<eT>&>(imageIn));
+      imagePlanes(static_cast<ImageYCbCr<eT>&>(image), plane0, plane1, plane2);
       break;
     default:
       throw logic_error("Unknown color space");
   }
 }
 
+template<class ImageT>
+void imagePlanes(const ImageT& image, const Mat<typename ImageT::elem_type>*& plane0,
+                 const Mat<typename ImageT::elem_type>*& plane1, const Mat<typename ImageT::elem_type>*& plane2) {
+  Mat<typename ImageT::elem_type>* planes[3];
+  imagePlanes(const_cast<ImageT&>(image), planes[0], planes[1], planes[2]);
+  plane0 = planes[0];
+  plane1 = planes[1];
+  plane2 = planes[2];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-// Functions to convert image of RGB to other color space.
+// Kernel application.
 ////////////////////////////////////////////////////////////////////////////////
 
-template<typename eT>
-void convert(ImageNormalizedRGB<eT>& imageOut, const ImageRGB<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+// Kernels are applied to n consecutive pixels split into bands, or to the
+// columns of a region split into groups of columns, and the bands run in
+// parallel when setThreadCount() allows it.
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT>
+void applyKernel(PixelKernel<eT> kernel, const eT* in0, const eT* in1, const eT* in2,
+                 eT* out0, eT* out1, eT* out2, const uword n) {
+  parallelFor(n, minTilePixels(), [&](const uword begin, const uword end) {
+    kernel(in0 + begin, in1 + begin, in2 + begin, out0 + begin, out1 + begin, out2 + begin, end - begin);
+  });
+}
 
-  imageOut.setSize(height, width);
+template<typename eT>
+void applyKernel(GrayToColorKernel<eT> kernel, const eT* grayIn, eT* out0, eT* out1, eT* out2, const uword n) {
+  parallelFor(n, minTilePixels(), [&](const uword begin, const uword end) {
+    kernel(grayIn + begin, out0 + begin, out1 + begin, out2 + begin, end - begin);
+  });
+}
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT r            = imageIn.r(i);
-    eT g            = imageIn.g(i);
-    eT b            = imageIn.b(i);
-    eT sum          = r + g + b;
-    eT normalizedR  = (r * 255 / sum);
-    eT normalizedG  = (g * 255 / sum);
-    eT normalizedB  = (b * 255 / sum);
+template<typename eT>
+void applyKernel(ColorToGrayKernel<eT> kernel, const eT* in0, const eT* in1, const eT* in2, eT* grayOut, const uword n) {
+  parallelFor(n, minTilePixels(), [&](const uword begin, const uword end) {
+    kernel(in0 + begin, in1 + begin, in2 + begin, grayOut + begin, end - begin);
+  });
+}
 
-    imageOut.normalizedR(i) = normalizedR;
-    imageOut.normalizedG(i) = normalizedG;
-    imageOut.normalizedB(i) = normalizedB;
+// Apply a kernel to every pixel of roiIn. The output planes must already have
+// the size of the region.
+template<typename eT>
+void convertPixels(PixelKernel<eT> kernel,
+                   Mat<eT>& out0, Mat<eT>& out1, Mat<eT>& out2, const ImageRGBRoi<eT>& roiIn) {
+  if (roiIn.isContiguous()) {
+    applyKernel(kernel, roiIn.r.mem, roiIn.g.mem, roiIn.b.mem,
+                out0.memptr(), out1.memptr(), out2.memptr(), (uword)roiIn.height * roiIn.width);
+    return;
   }
+  parallelFor(roiIn.width, minTileLines(roiIn.height), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++) {
+      kernel(roiIn.r.colptr(x), roiIn.g.colptr(x), roiIn.b.colptr(x),
+             out0.colptr(x), out1.colptr(x), out2.colptr(x), roiIn.height);
+    }
+  });
+}
+
+// Apply a kernel to whole images, of the given classes or of any color space.
+template<class ImageOut, class ImageIn>
+void convertPixels(PixelKernel<typename ImageIn::elem_type> kernel, ImageOut& imageOut, const ImageIn& imageIn) {
+  typedef typename ImageIn::elem_type eT;
+  Mat<eT>* out[3];
+  const Mat<eT>* in[3];
+  imageOut.setSize(imageIn.height, imageIn.width);
+  imagePlanes(imageOut, out[0], out[1], out[2]);
+  imagePlanes(imageIn, in[0], in[1], in[2]);
+  applyKernel(kernel, in[0]->memptr(), in[1]->memptr(), in[2]->memptr(),
+              out[0]->memptr(), out[1]->memptr(), out[2]->memptr(), (uword)imageIn.height * imageIn.width);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert image of other color space to RGB.
+////////////////////////////////////////////////////////////////////////////////
+
 template<typename eT>
-void convert(ImageXYZ<eT>& imageOut, const ImageRGB<eT>& imageIn) {
+void convert(ImageRGB<eT>& imageOut, const ImageNormalizedRGB<eT>& imageIn) {
   if (!imageIn.check())
     throw logic_error("Inconsistent height and width in imageIn");
-
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
-
-  imageOut.setSize(height, width);
-
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT r = imageIn.r(i) / 255.0;
-    eT g = imageIn.g(i) / 255.0;
-    eT b = imageIn.b(i) / 255.0;
-
-    if(r > 0.04045) { r = powf(((r+0.055)/1.055),2.4); }
-    else            { r = r/12.92;                     }
-
-    if(g > 0.04045) { g = powf(((g+0.055)/1.055),2.4); }
-    else            { g = g/12.92;                     }
-
-    if(b > 0.04045) { b = powf(((b+0.055)/1.055),2.4); }
-    else            { b = b/12.92;                     }
-
-    imageOut.x(i) = (r * 0.4124 * 100.0) + (g * 0.3576 * 100.0) + (b * 0.1805 * 100.0);
-    imageOut.y(i) = (r * 0.2126 * 100.0) + (g * 0.7152 * 100.0) + (b * 0.0722 * 100.0);
-    imageOut.z(i) = (r * 0.0193 * 100.0) + (g * 0.1192 * 100.0) + (b * 0.9505 * 100.0);
-  }
+  convertPixels(ConversionKernel<eT, false, NormalizedRGBSpace, RGBSpace>::select(), imageOut, imageIn);
 }
 
 template<typename eT>
-void convert(ImageLAB<eT>& imageOut, const ImageRGB<eT>& imageIn) {
+void convert(ImageRGB<eT>& imageOut, const ImageXYZ<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
   if (!imageIn.check())
     throw logic_error("Inconsistent height and width in imageIn");
+  convertPixels(conversionKernel<eT, RGBSpace, XYZSpace>(mode), imageOut, imageIn);
+}
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImageLAB<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convertPixels(conversionKernel<eT, RGBSpace, LABSpace>(mode), imageOut, imageIn);
+}
 
-  imageOut.setSize(height, width);
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImageHSV<eT>& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convertPixels(ConversionKernel<eT, false, HSVSpace, RGBSpace>::select(), imageOut, imageIn);
+}
 
-  ImageXYZ<eT> imageXyz;
-  convert(imageXyz, imageIn);   // Convert RGB to XYZ
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImageYCbCr<eT>& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convertPixels(ConversionKernel<eT, false, YCbCrSpace, RGBSpace>::select(), imageOut, imageIn);
+}
 
-  // Convert XYZ to L*a*b*
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT x = imageXyz.x(i) / 95.047;
-    eT y = imageXyz.y(i) / 100;
-    eT z = imageXyz.z(i) / 108.883;
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const Image<eT>& imageIn) {
+  convert(static_cast<Image<eT>&>(imageOut), imageIn);
+}
 
-    if ( x > 0.008856 ) { x = pow(x, (1.0/3.0));                }
-    else                { x = ( 7.787 * x ) + ( 16.0 / 116.0 ); }
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert image of RGB to other color space.
+////////////////////////////////////////////////////////////////////////////////
 
-    if ( y > 0.008856 ) { y = pow(y, ( 1.0/3.0 ));              }
-    else                { y = ( 7.787 * y ) + ( 16.0 / 116.0 ); }
+template<typename eT>
+void convert(ImageNormalizedRGB<eT>& imageOut, const ImageRGB<eT>& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn));
+}
 
-    if ( z > 0.008856 ) { z = pow(z, ( 1.0/3.0 ));              }
-    else                { z = ( 7.787 * z ) + ( 16.0 / 116.0 ); }
+template<typename eT>
+void convert(ImageXYZ<eT>& imageOut, const ImageRGB<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn), mode);
+}
 
-    imageOut.l(i) = ( 116 * y ) - 16;
-    imageOut.a(i) = 500 * ( x - y );
-    imageOut.b(i) = 200 * ( y - z );
-  }
+template<typename eT>
+void convert(ImageLAB<eT>& imageOut, const ImageRGB<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn), mode);
 }
 
 template<typename eT>
 void convert(ImageHSV<eT>& imageOut, const ImageRGB<eT>& imageIn) {
   if (!imageIn.check())
     throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn));
+}
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
-
-  imageOut.setSize(height, width);
-
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT r = imageIn.r(i) / 255.0;
-    eT g = imageIn.g(i) / 255.0;
-    eT b = imageIn.b(i) / 255.0;
-
-    const eT min = std::min(r, std::min(g, b));
-    const eT max = std::max(r, std::max(g, b));
-    eT del_Max   = max - min;
-
-    imageOut.v(i) = max;
+template<typename eT>
+void convert(ImageYCbCr<eT>& imageOut, const ImageRGB<eT>& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn));
+}
 
-    if ( del_Max == 0 )                     // This is a gray, no chroma
-    {
-      imageOut.h(i) = 0;                    // HSV results from 0 to 1
-      imageOut.s(i) = 0;
-    }
-    else                                    // Chromatic data
-    {
-      imageOut.s(i) = del_Max / max;
-      eT del_R = ( ( ( max - r ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
-      eT del_G = ( ( ( max - g ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
-      eT del_B = ( ( ( max - b ) / 6.0 ) + ( del_Max / 2.0 ) ) / del_Max;
+template<typename eT>
+void convert(Image<eT>& imageOut, const ImageRGB<eT>& imageIn) {
+  convert(imageOut, static_cast<const Image<eT>&>(imageIn));
+}
 
-      if      ( r == max ) imageOut.h(i) = del_B - del_G;
-      else if ( g == max ) imageOut.h(i) = ( 1.0 / 3.0 ) + del_R - del_B;
-      else if ( b == max ) imageOut.h(i) = ( 2.0 / 3.0 ) + del_G - del_R;
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert region of RGB image to other color space.
+////////////////////////////////////////////////////////////////////////////////
 
-      if ( imageOut.h(i) < 0 ) imageOut.h(i) += 1;
-      if ( imageOut.h(i) > 1 ) imageOut.h(i) -= 1;
-    }
-  }
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  roiIn.copyTo(imageOut);
 }
 
 template<typename eT>
-void convert(ImageYCbCr<eT>& imageOut, const ImageRGB<eT>& imageIn) {
-  if (!imageIn.check())
-    throw logic_error("Inconsistent height and width in imageIn");
+void convert(ImageNormalizedRGB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  convertPixels(ConversionKernel<eT, false, RGBSpace, NormalizedRGBSpace>::select(),
+                imageOut.normalizedR, imageOut.normalizedG, imageOut.normalizedB, roiIn);
+}
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
-  const u32 n_pixs = height * width;
+template<typename eT>
+void convert(ImageXYZ<eT>& imageOut, const ImageRGBRoi<eT>& roiIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  convertPixels(conversionKernel<eT, XYZSpace, RGBSpace>(mode),
+                imageOut.x, imageOut.y, imageOut.z, roiIn);
+}
 
-  imageOut.setSize(height, width);
+template<typename eT>
+void convert(ImageLAB<eT>& imageOut, const ImageRGBRoi<eT>& roiIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  convertPixels(conversionKernel<eT, LABSpace, RGBSpace>(mode),
+                imageOut.l, imageOut.a, imageOut.b, roiIn);
+}
 
-  for (u32 i = 0; i < n_pixs; i++)
-  {
-    eT r = imageIn.r(i) / 255;
-    eT g = imageIn.g(i) / 255;
-    eT b = imageIn.b(i) / 255;
+template<typename eT>
+void convert(ImageHSV<eT>& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  convertPixels(ConversionKernel<eT, false, RGBSpace, HSVSpace>::select(),
+                imageOut.h, imageOut.s, imageOut.v, roiIn);
+}
 
-    imageOut.y(i)  = ( ( ( ( 0.299000 * r) + ( 0.587000 * g )  + ( 0.114000 * b) )  ) );
-    imageOut.cb(i) = ( ( ( (-0.168736 * r) + (-0.331264 * g )  + ( 0.500000 * b) )  ) );
-    imageOut.cr(i) = ( ( ( ( 0.500000 * r) + (-0.418688 * g )  + (-0.081312 * b) )  ) );
-  }
+template<typename eT>
+void convert(ImageYCbCr<eT>& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  convertPixels(ConversionKernel<eT, false, RGBSpace, YCbCrSpace>::select(),
+                imageOut.y, imageOut.cb, imageOut.cr, roiIn);
 }
 
 template<typename eT>
-void convert(Image<eT>& imageOut, const ImageRGB<eT>& imageIn) {
-  switch (imageOut.colorSpace()) {
-    case COLORSPACE_RGB: {
-      static_cast<ImageRGB<eT>&>(imageOut) = imageIn;
-      break;
-    }
-    case COLORSPACE_NORMALIZEDRGB: {
-      convert(static_cast<ImageNormalizedRGB<eT>&>(imageOut), imageIn);
-      break;
-    }
-    case COLORSPACE_XYZ: {
-      convert(static_cast<ImageXYZ<eT>&>(imageOut), imageIn);
-      break;
-    }
-    case COLORSPACE_LAB: {
-      convert(static_cast<ImageLAB<eT>&>(imageOut), imageIn);
-      break;
-    }
-    case COLORSPACE_HSV: {
-      convert(static_cast<ImageHSV<eT>&>(imageOut), imageIn);
-      break;
-    }
-    case COLORSPACE_YCBCR: {
-      convert(static_cast<ImageYCbCr<eT>&>(imageOut), imageIn);
-      break;
-    }
-    default: {
-      throw logic_error("Unknown color space");
-    }
+void convert(Image<eT>& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  if (imageOut.colorSpace() == COLORSPACE_RGB) {
+    convert(static_cast<ImageRGB<eT>&>(imageOut), roiIn);
+    return;
   }
+  Mat<eT>* out[3];
+  imageOut.setSize(roiIn.height, roiIn.width);
+  imagePlanes(imageOut, out[0], out[1], out[2]);
+  convertPixels(conversionKernel<eT>(imageOut.colorSpace(), COLORSPACE_RGB, CONVERSION_DEFAULT),
+                *out[0], *out[1], *out[2], roiIn);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -977,18 +2746,25 @@ void convert(Image<eT>& imageOut, const ImageRGB<eT>& imageIn) {
 ////////////////////////////////////////////////////////////////////////////////
 
 template<typename eT>
-void convert(Image<eT>& imageOut, const Image<eT>& imageIn) {
-  if (imageOut.colorSpace() == COLORSPACE_RGB) {
-    convert(static_cast<ImageRGB<eT>&>(imageOut), imageIn);
-  }
-  else if (imageIn.colorSpace() == COLORSPACE_RGB) {
-    convert(imageOut, static_cast<const ImageRGB<eT>&>(imageIn));
-  }
-  else {
-    ImageRGB<eT> imageRgb;
-    convert(imageRgb, imageIn);
-    convert(imageOut, imageRgb);
-  }
+void convert(Image<eT>& imageOut, const Image<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  if (&imageOut == &imageIn)
+    return;
+  convertPixels(conversionKernel<eT>(imageOut.colorSpace(), imageIn.colorSpace(), mode), imageOut, imageIn);
+}
+
+template<class ImageOut, class ImageIn>
+typename enable_if<IsColorImage<ImageOut>::value && IsColorImage<ImageIn>::value &&
+                   is_same<typename ImageOut::elem_type, typename ImageIn::elem_type>::value>::type
+convert(ImageOut& imageOut, const ImageIn& imageIn, const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  typedef typename ImageIn::elem_type eT;
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  if ((const void*)&imageOut == (const void*)&imageIn)
+    return;
+  convertPixels(conversionKernel<eT, typename ImageOut::Space, typename ImageIn::Space>(mode), imageOut, imageIn);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1006,15 +2782,28 @@ void convert(ImageRGB<eT>& imageOut, const Mat<eT>& matIn) {
 }
 
 template<typename eT>
-void convert(Image<eT>& imageOut, const Mat<eT>& matIn) {
+void convert(Image<eT>& imageOut, const Mat<eT>& matIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
   if (imageOut.colorSpace() == COLORSPACE_RGB) {
     convert(static_cast<ImageRGB<eT>&>(imageOut), matIn);
+    return;
   }
-  else {
-    ImageRGB<eT> imageRgb;
-    convert(imageRgb, matIn);
-    convert(static_cast<ImageRGB<eT>&>(imageOut), imageRgb);
-  }
+  Mat<eT>* out[3];
+  imageOut.setSize(matIn.n_rows, matIn.n_cols);
+  imagePlanes(imageOut, out[0], out[1], out[2]);
+  applyKernel(useFastConversion(mode) ? grayToColorKernel<eT, true>(imageOut.colorSpace())
+                                      : grayToColorKernel<eT, false>(imageOut.colorSpace()),
+              matIn.memptr(), out[0]->memptr(), out[1]->memptr(), out[2]->memptr(), matIn.n_elem);
+}
+
+template<class ImageOut, typename eT>
+typename enable_if<IsColorImage<ImageOut>::value && is_same<typename ImageOut::elem_type, eT>::value>::type
+convert(ImageOut& imageOut, const Mat<eT>& matIn, const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  Mat<eT>* out[3];
+  imageOut.setSize(matIn.n_rows, matIn.n_cols);
+  imagePlanes(imageOut, out[0], out[1], out[2]);
+  applyKernel(grayToColorKernel<eT, typename ImageOut::Space>(mode),
+              matIn.memptr(), out[0]->memptr(), out[1]->memptr(), out[2]->memptr(), matIn.n_elem);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1025,24 +2814,80 @@ template<typename eT>
 void convert(Mat<eT>& matOut, const ImageRGB<eT>& imageIn) {
   if (!imageIn.check())
     throw logic_error("Inconsistent height and width in imageIn");
+  convert(matOut, ImageRGBRoi<eT>(imageIn));
+}
+
+template<typename eT>
+void convert(Mat<eT>& matOut, const Image<eT>& imageIn,
+             const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
 
-  const u32 height = imageIn.height;
-  const u32 width  = imageIn.width;
+  const Mat<eT>* in[3];
+  imagePlanes(imageIn, in[0], in[1], in[2]);
+  matOut.set_size(imageIn.height, imageIn.width);
+  applyKernel(useFastConversion(mode) ? colorToGrayKernel<eT, true>(imageIn.colorSpace())
+                                      : colorToGrayKernel<eT, false>(imageIn.colorSpace()),
+              in[0]->memptr(), in[1]->memptr(), in[2]->memptr(), matOut.memptr(), matOut.n_elem);
+}
 
-  matOut.set_size(height, width);
-  matOut = 0.2126*imageIn.r + 0.7152*imageIn.g + 0.0722*imageIn.b;
+template<typename eT, class ImageIn>
+typename enable_if<IsColorImage<ImageIn>::value && is_same<typename ImageIn::elem_type, eT>::value>::type
+convert(Mat<eT>& matOut, const ImageIn& imageIn, const ConversionMode mode /* default: CONVERSION_DEFAULT */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+
+  const Mat<eT>* in[3];
+  imagePlanes(imageIn, in[0], in[1], in[2]);
+  matOut.set_size(imageIn.height, imageIn.width);
+  applyKernel(colorToGrayKernel<eT, typename ImageIn::Space>(mode),
+              in[0]->memptr(), in[1]->memptr(), in[2]->memptr(), matOut.memptr(), matOut.n_elem);
 }
 
 template<typename eT>
-void convert(Mat<eT>& matOut, const Image<eT>& imageIn) {
-  if (imageIn.colorSpace() == COLORSPACE_RGB) {
-    convert(matOut, static_cast<const ImageRGB<eT>&>(imageIn));
+void convert(Mat<eT>& matOut, const ImageRGBRoi<eT>& roiIn) {
+  if (roiIn.r.overlaps(matOut) || roiIn.g.overlaps(matOut) || roiIn.b.overlaps(matOut)) {
+    // Resizing matOut could free the memory of the region.
+    Mat<eT> matConverted;
+    convert(matConverted, roiIn);
+    matOut.steal_mem(matConverted);
+    return;
   }
-  else {
-    ImageRGB<eT> imageRgb;
-    convert(imageRgb, imageIn);
-    convert(matOut, static_cast<const ImageRGB<eT>&>(imageIn));
+  const ColorToGrayKernel<eT> kernel = SimdKernel<ColorToGrayPixels<eT, false, RGBSpace> >::select();
+  matOut.set_size(roiIn.height, roiIn.width);
+  if (roiIn.isContiguous()) {
+    applyKernel(kernel, roiIn.r.mem, roiIn.g.mem, roiIn.b.mem, matOut.memptr(), (uword)roiIn.height * roiIn.width);
+    return;
   }
+  parallelFor(roiIn.width, minTileLines(roiIn.height), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++)
+      kernel(roiIn.r.colptr(x), roiIn.g.colptr(x), roiIn.b.colptr(x), matOut.colptr(x), roiIn.height);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to convert between packed and planar color images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void convert(ImagePacked& imageOut, const ImageRGB<eT>& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  convert(imageOut, ImageRGBRoi<eT>(imageIn));
+}
+
+template<typename eT>
+void convert(ImagePacked& imageOut, const ImageRGBRoi<eT>& roiIn) {
+  imageOut.setSize(roiIn.height, roiIn.width);
+  packPixels(imageOut, roiIn.r.mem, roiIn.r.stride, roiIn.g.mem, roiIn.g.stride, roiIn.b.mem, roiIn.b.stride);
+}
+
+template<typename eT>
+void convert(ImageRGB<eT>& imageOut, const ImagePacked& imageIn) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  imageOut.setSize(imageIn.height, imageIn.width);
+  unpackPixels(imageOut.r.memptr(), imageOut.g.memptr(), imageOut.b.memptr(), imageOut.height, imageIn);
 }
 
 }  /* namespace sense */
@@ -0,0 +1,114 @@
+#include "imagecache.h"
+#include <QImageReader>
+#include <QMutexLocker>
+#include <climits>
+
+ImageDecoder::ImageDecoder(QObject *parent) :
+    QObject(parent),
+    running(false)
+{
+}
+
+void ImageDecoder::setQueue(const QStringList &paths)
+{
+    QMutexLocker locker(&mutex);
+    queue = paths;
+    queue.removeAll(current);   // Already on its way
+
+    if(!running && !queue.isEmpty())
+    {
+        running = true;
+        QMetaObject::invokeMethod(this, "decodeQueue", Qt::QueuedConnection);
+    }
+}
+
+bool ImageDecoder::takeNext(QString &path)
+{
+    QMutexLocker locker(&mutex);
+    if(queue.isEmpty())
+    {
+        running = false;
+        current.clear();
+        return false;
+    }
+    current = queue.takeFirst();
+    path = current;
+    return true;
+}
+
+void ImageDecoder::decodeQueue()
+{
+    QString path;
+    while(takeNext(path))
+    {
+        QImageReader reader(path);
+        QImage image = reader.read();
+
+        //Convert to the format of the screen here rather than on the GUI thread
+        if(!image.isNull())
+            image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                  : QImage::Format_RGB32);
+        emit decoded(path, image);
+    }
+}
+
+ImageCache::ImageCache(QObject *parent) :
+    QObject(parent),
+    decoder(new ImageDecoder)
+{
+    decoder->moveToThread(&thread);
+    connect(decoder, SIGNAL(decoded(QString,QImage)), this, SLOT(addImage(QString,QImage)));
+    thread.start(QThread::LowPriority);
+}
+
+ImageCache::~ImageCache()
+{
+    decoder->setQueue(QStringList());
+    thread.quit();
+    thread.wait();
+    delete decoder;
+}
+
+void ImageCache::setMaxBytes(qint64 bytes)
+{
+    cache.setMaxCost((int)qMin(bytes / 1024, (qint64)INT_MAX));
+}
+
+QPixmap *ImageCache::find(const QString &path)
+{
+    if(path == largePath)
+        return &largePixmap;
+    return cache.object(path);
+}
+
+void ImageCache::load(const QString &path, const QStringList &prefetch)
+{
+    QStringList queue;
+    if(!find(path))
+        queue << path;
+    foreach(const QString &item, prefetch)
+    {
+        if(!cache.contains(item) && item != largePath)
+            queue << item;
+    }
+    decoder->setQueue(queue);
+}
+
+void ImageCache::addImage(const QString &path, const QImage &image)
+{
+    //Images that fail to decode are cached as null pixmaps, so that they are
+    //not decoded again
+    const qint64 bytes = (qint64)image.bytesPerLine() * image.height();
+    const int cost = (int)qMax(bytes / 1024, (qint64)1);
+
+    if(cost <= cache.maxCost())
+    {
+        cache.insert(path, new QPixmap(QPixmap::fromImage(image)), cost);
+    }
+    else
+    {
+        largePath = path;
+        largePixmap = QPixmap::fromImage(image);
+    }
+    emit imageReady(path);
+}
@@ -0,0 +1,73 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+// Decodes images on the thread it lives in, one at a time, in the order of a
+// queue that the GUI thread can replace at any time.
+class ImageDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageDecoder(QObject *parent = 0);
+
+    void setQueue(const QStringList &paths);
+
+signals:
+    void decoded(const QString &path, const QImage &image);
+
+private slots:
+    void decodeQueue();
+
+private:
+    QMutex      mutex;      // Protects the members below
+    QStringList queue;
+    QString     current;    // Image being decoded
+    bool        running;
+
+    bool takeNext(QString &path);
+};
+
+// Memory-bounded LRU cache of decoded images. Images missing from the cache
+// are decoded on a worker thread, and imageReady() is emitted when one of
+// them is available.
+class ImageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageCache(QObject *parent = 0);
+    ~ImageCache();
+
+    void setMaxBytes(qint64 bytes);
+
+    // Return the image if it is available, or 0.
+    QPixmap *find(const QString &path);
+
+    // Decode path, then the images of prefetch, unless they are available.
+    // Images requested by earlier calls that are not decoded yet are dropped.
+    void load(const QString &path, const QStringList &prefetch);
+
+signals:
+    void imageReady(const QString &path);
+
+private slots:
+    void addImage(const QString &path, const QImage &image);
+
+private:
+    QCache<QString, QPixmap> cache;     // Cost in KB
+    QString                  largePath; // Last image too large for the cache
+    QPixmap                  largePixmap;
+    QThread                  thread;
+    ImageDecoder            *decoder;
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,115 @@
+#ifndef __INTEGRAL_H__
+#define __INTEGRAL_H__
+
+#include <armadillo>
+#include <type_traits>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Integral image classes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Type of the sums of an integral image of elements of type eT: s64 for
+// integer images, whose sums are exact (squares of 8- and 16-bit values
+// cannot overflow below 2^31 pixels), and double for floating-point images.
+
+template<typename eT>
+struct IntegralSum {
+  typedef typename conditional<is_integral<eT>::value, s64, double>::type type;
+};
+
+// Summed-area table of a grayscale image. sum(y, x) holds the sum of the
+// pixels above and to the left of (y, x), so sum has one more row and column
+// than the image and its first row and column are 0. sumSquares holds the
+// same for the squares of the pixels, and is empty unless requested.
+//
+// The box functions return the sum, mean or variance of the height x width
+// box whose top left pixel is (y, x) with four lookups, whatever the size of
+// the box. Boxes are not checked: they must lie inside the image and not be
+// empty. The variance needs sumSquares. For floating-point images it is
+// computed as E[x^2] - E[x]^2, so it loses precision on boxes whose mean is
+// large compared to their standard deviation; negative results of rounding
+// are returned as 0.
+
+template<typename eT>
+class IntegralImage {
+  public:
+    typedef typename IntegralSum<eT>::type sum_type;
+    u32 height;
+    u32 width;
+    Mat<sum_type> sum;
+    Mat<sum_type> sumSquares;
+    IntegralImage() : height(0), width(0) {}
+    bool hasSquares() const { return (sumSquares.n_rows == sum.n_rows && sumSquares.n_cols == sum.n_cols); }
+    sum_type boxSum(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const {
+      return boxValue(sum, y, x, boxHeight, boxWidth);
+    }
+    sum_type boxSumSquares(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const {
+      return boxValue(sumSquares, y, x, boxHeight, boxWidth);
+    }
+    double boxMean(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const;
+    double boxVariance(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const;
+    bool check() const;
+    void print(ostream& stream) const;
+  private:
+    static sum_type boxValue(const Mat<sum_type>& table, const u32 y, const u32 x,
+                             const u32 boxHeight, const u32 boxWidth) {
+      return table.at(y + boxHeight, x + boxWidth) - table.at(y, x + boxWidth)
+             - table.at(y + boxHeight, x) + table.at(y, x);
+    }
+};
+
+// Summed-area tables of the R, G and B planes of an image.
+
+template<typename eT>
+class IntegralImageRGB {
+  public:
+    IntegralImage<eT> r;
+    IntegralImage<eT> g;
+    IntegralImage<eT> b;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to build integral images.
+////////////////////////////////////////////////////////////////////////////////
+
+// Build the summed-area table (and, if squares is true, the table of squares)
+// of a grayscale image, a region of one, or each plane of an RGB image. The
+// tables are built in two passes: cumulative sums down the columns, in
+// parallel over columns, then across the columns, in parallel over bands of
+// rows. Each sum is added up in the same order whatever the number of
+// threads, so the result does not depend on it.
+//
+// Tables that already have the right size are reused, so rebuilding the
+// integral image of frames of the same size does not allocate.
+
+template<typename eT>
+void integral(IntegralImage<eT>& integralOut, const Mat<eT>& matIn, const bool squares = true);
+
+template<typename eT>
+void integral(IntegralImage<eT>& integralOut, const MatRoi<eT>& roiIn, const bool squares = true);
+
+template<typename eT>
+void integral(IntegralImageRGB<eT>& integralOut, const ImageRGB<eT>& imageIn, const bool squares = true);
+
+template<typename eT>
+void integral(IntegralImageRGB<eT>& integralOut, const ImageRGBRoi<eT>& roiIn, const bool squares = true);
+
+////////////////////////////////////////////////////////////////////////////////
+// Overloaded operators.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+ostream& operator<<(ostream& stream, const IntegralImage<eT>& integralImage);
+
+}  /* namespace sense */
+
+#include "integral_impl.h"
+
+#endif  /* __INTEGRAL_H__ */
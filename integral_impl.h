@@ -0,0 +1,156 @@
+#ifndef __INTEGRAL_IMPL_H__
+#define __INTEGRAL_IMPL_H__
+
+#include <algorithm>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Give table the size of a summed-area table of a height x width image, and
+// zero its first row and column. Tables of the right size are kept.
+template<typename sT>
+void setTableSize(Mat<sT>& table, const u32 height, const u32 width) {
+  if (table.n_rows != height + 1 || table.n_cols != width + 1)
+    table.set_size(height + 1, width + 1);
+  std::fill(table.colptr(0), table.colptr(0) + height + 1, sT(0));
+  for (u32 x = 1; x <= width; x++)
+    table.at(0, x) = 0;
+}
+
+// First pass: cumulative sums down the columns of roiIn, stored one row and
+// one column further in the tables. tableSquares may be NULL.
+template<typename eT, typename sT>
+void sumColumns(Mat<sT>& table, Mat<sT>* tableSquares, const MatRoi<eT>& roiIn) {
+  const u32 height = roiIn.height;
+  parallelFor(roiIn.width, minTileLines(height), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++) {
+      const eT* in = roiIn.colptr(x);
+      sT* out = table.colptr(x + 1) + 1;
+      sT running = 0;
+      for (u32 y = 0; y < height; y++) {
+        running += (sT)in[y];
+        out[y] = running;
+      }
+      if (tableSquares == NULL)
+        continue;
+      sT* outSquares = tableSquares->colptr(x + 1) + 1;
+      sT runningSquares = 0;
+      for (u32 y = 0; y < height; y++) {
+        runningSquares += (sT)in[y] * (sT)in[y];
+        outSquares[y] = runningSquares;
+      }
+    }
+  });
+}
+
+// Second pass: cumulative sums across the columns of a table. A band of rows
+// adds each column to the next one, so the inner loop runs down contiguous
+// memory and vectorizes.
+template<typename sT>
+void sumRows(Mat<sT>& table) {
+  const u32 rows = table.n_rows;
+  const u32 cols = table.n_cols;
+  parallelFor(rows, minTileLines(cols), [&](const uword begin, const uword end) {
+    for (u32 x = 1; x < cols; x++) {
+      const sT* previous = table.colptr(x - 1);
+      sT* out = table.colptr(x);
+      for (uword y = begin; y < end; y++)
+        out[y] += previous[y];
+    }
+  });
+}
+
+template<typename eT>
+void buildIntegral(IntegralImage<eT>& integralOut, const MatRoi<eT>& roiIn, const bool squares) {
+  typedef typename IntegralImage<eT>::sum_type sT;
+  integralOut.height = roiIn.height;
+  integralOut.width = roiIn.width;
+  setTableSize(integralOut.sum, roiIn.height, roiIn.width);
+  if (squares)
+    setTableSize(integralOut.sumSquares, roiIn.height, roiIn.width);
+  else
+    integralOut.sumSquares.reset();
+
+  sumColumns<eT, sT>(integralOut.sum, squares ? &integralOut.sumSquares : NULL, roiIn);
+  sumRows(integralOut.sum);
+  if (squares)
+    sumRows(integralOut.sumSquares);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IntegralImage implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+double IntegralImage<eT>::boxMean(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const {
+  return (double)boxSum(y, x, boxHeight, boxWidth) / ((double)boxHeight * boxWidth);
+}
+
+template<typename eT>
+double IntegralImage<eT>::boxVariance(const u32 y, const u32 x, const u32 boxHeight, const u32 boxWidth) const {
+  const double n = (double)boxHeight * boxWidth;
+  const double mean = (double)boxSum(y, x, boxHeight, boxWidth) / n;
+  const double variance = (double)boxSumSquares(y, x, boxHeight, boxWidth) / n - mean * mean;
+  return (variance > 0) ? variance : 0;
+}
+
+template<typename eT>
+bool IntegralImage<eT>::check() const {
+  if (sum.n_rows != height + 1 || sum.n_cols != width + 1)
+    return false;
+  return (sumSquares.is_empty() || hasSquares());
+}
+
+template<typename eT>
+void IntegralImage<eT>::print(ostream& stream) const {
+  stream << "Height     : " << height << endl;
+  stream << "Width      : " << width << endl;
+  stream << "Sum: " << endl << sum << endl;
+  if (hasSquares())
+    stream << "Sum of squares: " << endl << sumSquares << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to build integral images.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void integral(IntegralImage<eT>& integralOut, const Mat<eT>& matIn, const bool squares /* default: true */) {
+  buildIntegral(integralOut, MatRoi<eT>(matIn), squares);
+}
+
+template<typename eT>
+void integral(IntegralImage<eT>& integralOut, const MatRoi<eT>& roiIn, const bool squares /* default: true */) {
+  buildIntegral(integralOut, roiIn, squares);
+}
+
+template<typename eT>
+void integral(IntegralImageRGB<eT>& integralOut, const ImageRGB<eT>& imageIn, const bool squares /* default: true */) {
+  if (!imageIn.check())
+    throw logic_error("Inconsistent height and width in imageIn");
+  integral(integralOut, ImageRGBRoi<eT>(imageIn), squares);
+}
+
+template<typename eT>
+void integral(IntegralImageRGB<eT>& integralOut, const ImageRGBRoi<eT>& roiIn, const bool squares /* default: true */) {
+  buildIntegral(integralOut.r, roiIn.r, squares);
+  buildIntegral(integralOut.g, roiIn.g, squares);
+  buildIntegral(integralOut.b, roiIn.b, squares);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Overloaded operators.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+ostream& operator<<(ostream& stream, const IntegralImage<eT>& integralImage) {
+  integralImage.print(stream);
+  return stream;
+}
+
+}  /* namespace sense */
+
+#endif  /* __INTEGRAL_IMPL_H__ */
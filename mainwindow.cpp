@@ -1,5 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "imagecache.h"
+#include "directoryscanner.h"
+#include "thumbnailcache.h"
 #include <QtCore>
 #include <QPixmap>
 #include <QPainter>
@@ -8,7 +11,26 @@
 #include <QStringList>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QScrollBar>
+#include <algorithm>
 
+//Number of images decoded ahead on each side of the shown one, and memory
+//kept for decoded images
+static const int    PREFETCH_COUNT = 2;
+static const qint64 CACHE_BYTES    = 512LL * 1024 * 1024;
+
+//Largest side of the thumbnails of the strip, disk space kept for them, and
+//number of thumbnails on each side of the shown image made before the others
+//when the visible part of the strip is not known yet
+static const int    THUMBNAIL_SIZE        = 96;
+static const qint64 THUMBNAIL_CACHE_BYTES = 256LL * 1024 * 1024;
+static const int    THUMBNAIL_AHEAD       = 10;
+
+//Images are listed in the order of QDir::entryList: by name, ignoring case
+static bool nameLessThan(const QString &a, const QString &b)
+{
+    return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+}
 
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -16,6 +38,24 @@ MainWindow::MainWindow(QWidget *parent) :
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+
+    imageCache = new ImageCache(this);
+    imageCache->setMaxBytes(CACHE_BYTES);
+    connect(imageCache, SIGNAL(imageReady(QString)), this, SLOT(imageReady(QString)));
+
+    scanner = new DirectoryScanner(this);
+    scanner->setNameFilters(QStringList() << "*.jpg" << "*.jpeg" << "*.png" << "*.bmp" << "*.tif" << "*.tiff");
+    connect(scanner, SIGNAL(filesAdded(QStringList)), this, SLOT(filesAdded(QStringList)));
+
+    thumbnailCache = new ThumbnailCache(THUMBNAIL_SIZE, THUMBNAIL_CACHE_BYTES, this);
+    connect(thumbnailCache, SIGNAL(thumbnailReady(QString,QImage)), this, SLOT(thumbnailReady(QString,QImage)));
+    connect(ui->listThumbnails->horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(prioritizeThumbnails()));
+
+    //Shown until the thumbnail of an image is ready
+    QPixmap placeholder(THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+    placeholder.fill(Qt::lightGray);
+    placeholderIcon = QIcon(placeholder);
+    ui->listThumbnails->setIconSize(QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
 }
 
 MainWindow::~MainWindow()
@@ -30,32 +70,25 @@ void MainWindow::on_toolButton_clicked()
     //ui->label_pic->setPixmap(pix);
     //QMessageBox::information(this,tr("File Name"), fileName);
 
+    //Initialization code here (& other tasks)
+    QString newDirname = QFileDialog::getExistingDirectory(this, tr("Select a Directory"),QDir::currentPath() );
+    if(newDirname.isEmpty())
+        return;
+    dirname = newDirname;
+
     //Polamin >> Clear Old List and List count
     imagesList.clear();
     imagesCount = 0;
+    currentPath.clear();
+    ui->label_pic->clear();
+    thumbnailCache->clear();
+    ui->listThumbnails->clear();
+    ui->btNext->setEnabled(false);
+    ui->btPrevious->setEnabled(false);
 
-
-    //Initialization code here (& other tasks)
-    dirname = QFileDialog::getExistingDirectory(this, tr("Select a Directory"),QDir::currentPath() );
-    //Create a QDir that points out to your path in the resources folder
-    QDir directory(dirname);
-    //Load all files with the *.PNG extension
-    imagesList = directory.entryList(QStringList("*.jpg"));
-    //QStringList filters;
-    //filters << "*.png" << "*.jpg" << "*.bmp";
-    //fileInfoList = dir.entryInfoList(filters, QDir::Files|QDir::NoDotAndDotDot);
-
-
-    if(!imagesList.empty())
-    {
-        //Polamin >> If found image Enable next Button
-        if(imagesList.size()>1)
-            ui->btNext->setEnabled(true);
-
-        QString ts = dirname + "/" + imagesList[0];
-        QPixmap pix(ts);
-        ui->label_pic->setPixmap(pix);
-    }
+    //List the images in the background; filesAdded() receives them as they
+    //are found, and later when files are added to the directory
+    scanner->scan(dirname);
 
 
     /*
@@ -97,8 +130,181 @@ void MainWindow::on_btNext_clicked()
 
 void MainWindow::showImage(QString path)
 {
-    //This function just show Image
-    QString ts = dirname + "/" + path;
-    QPixmap pix(ts);
-    ui->label_pic->setPixmap(pix);
+    //Show the image if it is cached, otherwise when it has been decoded, and
+    //decode its neighbours ahead of time
+    currentPath = dirname + "/" + path;
+
+    QStringList prefetch;
+    const int current = imagesCount;
+    for(int i = 1; i <= PREFETCH_COUNT; i++)
+    {
+        if(current + i < imagesList.size())
+            prefetch << dirname + "/" + imagesList[current + i];
+        if(current - i >= 0)
+            prefetch << dirname + "/" + imagesList[current - i];
+    }
+
+    QPixmap *pix = imageCache->find(currentPath);
+    if(pix)
+        ui->label_pic->setPixmap(*pix);
+    else
+        ui->label_pic->clear();
+    imageCache->load(currentPath, prefetch);
+
+    ui->listThumbnails->setCurrentRow(current);
+    prioritizeThumbnails();
+}
+
+void MainWindow::prioritizeThumbnails()
+{
+    //Make the thumbnails of the visible part of the strip first, or of the
+    //shown image and its neighbours while the strip is not laid out yet
+    const QListWidget *list = ui->listThumbnails;
+    const QRect view = list->viewport()->rect();
+    int first = list->indexAt(QPoint(view.left() + 1, view.center().y())).row();
+    int last = list->indexAt(QPoint(view.right() - 1, view.center().y())).row();
+    if(first < 0)
+    {
+        first = qMax((int)imagesCount - THUMBNAIL_AHEAD, 0);
+        last = (int)imagesCount + THUMBNAIL_AHEAD;
+    }
+    else if(last < 0)
+    {
+        last = imagesList.size() - 1;
+    }
+    last = qMin(last, imagesList.size() - 1);
+
+    //The shown image first, then the rest from left to right
+    QStringList paths;
+    if((int)imagesCount < imagesList.size())
+        paths << dirname + "/" + imagesList[imagesCount];
+    for(int row = first; row <= last; row++)
+    {
+        if(row != (int)imagesCount)
+            paths << dirname + "/" + imagesList[row];
+    }
+    thumbnailCache->prioritize(paths);
+}
+
+int MainWindow::imageRow(const QString &name) const
+{
+    QStringList::const_iterator it = std::lower_bound(imagesList.constBegin(), imagesList.constEnd(), name, nameLessThan);
+    for(; it != imagesList.constEnd() && !nameLessThan(name, *it); ++it)
+    {
+        if(*it == name)
+            return int(it - imagesList.constBegin());
+    }
+    return -1;
+}
+
+void MainWindow::filesAdded(const QStringList &names)
+{
+    const bool first = imagesList.empty();
+
+    //Files are found in directory order, so merge each batch into the sorted
+    //list. rows[i] is the row of the i-th name of the batch in the new list
+    QStringList batch = names;
+    std::sort(batch.begin(), batch.end(), nameLessThan);
+    QList<int> rows;
+    if(first || !nameLessThan(batch.first(), imagesList.last()))
+    {
+        //New captures usually sort after every listed file
+        for(int i = 0; i < batch.size(); i++)
+            rows << imagesList.size() + i;
+        imagesList << batch;
+    }
+    else
+    {
+        QStringList merged;
+        merged.reserve(imagesList.size() + batch.size());
+        unsigned int before = 0;    // Names inserted before the current image
+        int listed = 0;
+        foreach(const QString &name, batch)
+        {
+            while(listed < imagesList.size() && !nameLessThan(name, imagesList[listed]))
+                merged << imagesList[listed++];
+            if((unsigned int)listed <= imagesCount)
+                before++;
+            rows << merged.size();
+            merged << name;
+        }
+        while(listed < imagesList.size())
+            merged << imagesList[listed++];
+        imagesList.swap(merged);
+        imagesCount += before;
+    }
+
+    //Add the images to the strip, inserting each run of consecutive rows at
+    //once, and make their thumbnails. The current row moves with the current
+    //image, which stays shown
+    ui->listThumbnails->blockSignals(true);
+    QStringList paths;
+    for(int i = 0; i < batch.size(); )
+    {
+        QStringList labels;
+        labels << QString();
+        while(i + labels.size() < batch.size() && rows[i + labels.size()] == rows[i] + labels.size())
+            labels << QString();
+        const int run = labels.size();
+        ui->listThumbnails->insertItems(rows[i], labels);
+        for(int k = 0; k < run; k++)
+        {
+            QListWidgetItem *item = ui->listThumbnails->item(rows[i] + k);
+            item->setIcon(placeholderIcon);
+            item->setToolTip(batch[i + k]);
+            paths << dirname + "/" + batch[i + k];
+        }
+        i += run;
+    }
+    if(!first)
+        ui->listThumbnails->setCurrentRow(imagesCount);
+    ui->listThumbnails->blockSignals(false);
+    thumbnailCache->load(paths);
+
+    //Show the first image as soon as it is found
+    if(first)
+        showImage(imagesList[0]);
+    else
+        prioritizeThumbnails();
+
+    //Polamin >> If found image Enable next Button
+    ui->btPrevious->setEnabled(imagesCount > 0);
+    if(imagesCount + 1 < (unsigned int)imagesList.size())
+        ui->btNext->setEnabled(true);
+}
+
+void MainWindow::imageReady(const QString &path)
+{
+    if(path != currentPath)
+        return;
+
+    QPixmap *pix = imageCache->find(path);
+    if(pix)
+        ui->label_pic->setPixmap(*pix);
+}
+
+void MainWindow::thumbnailReady(const QString &path, const QImage &thumbnail)
+{
+    //Thumbnails of a previous directory may still arrive
+    const QString prefix = dirname + "/";
+    if(thumbnail.isNull() || !path.startsWith(prefix))
+        return;
+    const int row = imageRow(path.mid(prefix.size()));
+    if(row < 0)
+        return;
+
+    ui->listThumbnails->item(row)->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+}
+
+void MainWindow::on_listThumbnails_currentRowChanged(int row)
+{
+    //Rows selected by showImage() are already shown
+    if(row < 0 || (unsigned int)row == imagesCount)
+        return;
+
+    imagesCount = row;
+    showImage(imagesList[imagesCount]);
+
+    ui->btPrevious->setEnabled(imagesCount > 0);
+    ui->btNext->setEnabled(imagesCount + 1 < (unsigned int)imagesList.size());
 }
@@ -1,10 +1,16 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QIcon>
+#include <QImage>
 #include <QMainWindow>
 #include <QStringList>
 #include <QString>
 
+class DirectoryScanner;
+class ImageCache;
+class ThumbnailCache;
+
 namespace Ui {
 class MainWindow;
 }
@@ -25,13 +31,29 @@ private slots:
 
     void on_btNext_clicked();
 
+    void imageReady(const QString &path);
+
+    void filesAdded(const QStringList &names);
+
+    void thumbnailReady(const QString &path, const QImage &thumbnail);
+
+    void on_listThumbnails_currentRowChanged(int row);
+
+    void prioritizeThumbnails();
+
 private:
     Ui::MainWindow *ui;
     QStringList     imagesList;
     unsigned int    imagesCount;
     QString         dirname;
+    ImageCache     *imageCache;
+    DirectoryScanner *scanner;
+    ThumbnailCache *thumbnailCache;
+    QIcon           placeholderIcon;
+    QString         currentPath;
 
     void showImage(QString);
+    int imageRow(const QString &name) const;   // -1 if not listed
 
 };
 
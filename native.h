@@ -0,0 +1,130 @@
+#ifndef __NATIVE_H__
+#define __NATIVE_H__
+
+#include <armadillo>
+#include <string>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Native image format.
+////////////////////////////////////////////////////////////////////////////////
+
+// Binary format holding the planes of an image exactly as they are in memory,
+// for intermediate results (e.g. L*a*b* or HSV planes, feature planes) that
+// are saved once and loaded many times. Nothing is encoded or converted, so
+// any color space and element type round-trips exactly, and files can be
+// memory-mapped and used in place.
+//
+// A file is a 64-byte header followed by the planes. The header holds a
+// magic string, a version, a byte-order mark, the element type and size, the
+// color space (or grayscale), the number of planes, the height, the width
+// and the distance between the starts of two planes. Each plane is stored
+// column by column, as in Mat<eT>, and starts at a multiple of 64 bytes from
+// the start of the file. Files are written in the byte order of the machine
+// and read only on machines of the same byte order.
+
+// Element types of the native format.
+
+enum NativeElemType {
+  NATIVE_U8 = 1,
+  NATIVE_U16 = 2,
+  NATIVE_S16 = 3,
+  NATIVE_U32 = 4,
+  NATIVE_S32 = 5,
+  NATIVE_U64 = 6,
+  NATIVE_S64 = 7,
+  NATIVE_FLOAT = 8,
+  NATIVE_DOUBLE = 9
+};
+
+// Color space written for grayscale Mat<eT> images.
+
+const s32 NATIVE_GRAYSCALE = -1;
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to load and save images in the native format.
+////////////////////////////////////////////////////////////////////////////////
+
+// Save color images of any color space and grayscale images.
+
+template<typename eT>
+bool saveNative(const Image<eT>& image, const string& path);
+
+template<typename eT>
+bool saveNative(const Mat<eT>& mat, const string& path);
+
+// Load images by copying their planes out of the file. The file must hold
+// elements of type eT and the color space of image (or grayscale, for
+// Mat<eT>); images are not converted.
+
+template<typename eT>
+bool loadNative(Image<eT>& image, const string& path);
+
+template<typename eT>
+bool loadNative(Mat<eT>& mat, const string& path);
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory-mapped files.
+////////////////////////////////////////////////////////////////////////////////
+
+// Private (copy-on-write) mapping of a whole file. Pages are read from disk
+// when first touched, and writes to them are never written back to the file.
+
+class MappedFile {
+  public:
+    MappedFile();
+    ~MappedFile();
+    bool open(const string& path);
+    void close();
+    bool isOpen() const { return (mem != NULL); }
+    u8* data() const { return mem; }
+    uword size() const { return length; }
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    u8* mem;
+    uword length;
+};
+
+// Image in the native format used in place. ImageT is one of the image
+// classes (e.g. ImageLAB<float>) or Mat<eT>. The planes of image() are
+// matrices over the mapped file, so opening a file neither allocates nor
+// copies pixels, whatever its size. The planes can be read and written (the
+// file is not changed) but not resized, and they are valid until close(),
+// another open() or the destruction of the MappedImage; copy them to keep
+// them longer.
+
+template<class ImageT>
+class MappedImage {
+  public:
+    MappedImage() {}
+    ~MappedImage() { close(); }
+
+    // Map the file. Returns false if the file cannot be mapped or does not
+    // hold an image of the color space and element type of ImageT.
+    bool open(const string& path);
+
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    ImageT& image() { return data; }
+    const ImageT& image() const { return data; }
+  private:
+    MappedImage(const MappedImage&);
+    MappedImage& operator=(const MappedImage&);
+
+    MappedFile file;
+    ImageT data;
+};
+
+}  /* namespace sense */
+
+#include "native_impl.h"
+
+#endif  /* __NATIVE_H__ */
@@ -0,0 +1,326 @@
+#ifndef __NATIVE_IMPL_H__
+#define __NATIVE_IMPL_H__
+
+#include <cstring>
+#include <fstream>
+#include <new>
+
+// NOTE: The following includes must be outside the "sense" namespace.
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+const char NATIVE_MAGIC[8] = {'S', 'E', 'N', 'S', 'E', 'I', 'M', 'G'};
+const u32 NATIVE_VERSION = 1;
+const u32 NATIVE_BYTE_ORDER = 0x01020304;
+const u64 NATIVE_ALIGNMENT = 64;
+
+struct NativeHeader {
+  char magic[8];
+  u32 version;
+  u32 byteOrder;
+  u32 elemType;
+  u32 elemSize;
+  s32 colorSpace;
+  u32 planes;
+  u32 height;
+  u32 width;
+  u64 planeStride;  // Bytes between the starts of two planes
+  u8 reserved[16];
+};
+
+static_assert(sizeof(NativeHeader) == NATIVE_ALIGNMENT, "Native header must fill its alignment");
+
+template<typename eT> struct NativeElemTypeOf;
+template<> struct NativeElemTypeOf<u8> { static const u32 value = NATIVE_U8; };
+template<> struct NativeElemTypeOf<u16> { static const u32 value = NATIVE_U16; };
+template<> struct NativeElemTypeOf<s16> { static const u32 value = NATIVE_S16; };
+template<> struct NativeElemTypeOf<u32> { static const u32 value = NATIVE_U32; };
+template<> struct NativeElemTypeOf<s32> { static const u32 value = NATIVE_S32; };
+template<> struct NativeElemTypeOf<u64> { static const u32 value = NATIVE_U64; };
+template<> struct NativeElemTypeOf<s64> { static const u32 value = NATIVE_S64; };
+template<> struct NativeElemTypeOf<float> { static const u32 value = NATIVE_FLOAT; };
+template<> struct NativeElemTypeOf<double> { static const u32 value = NATIVE_DOUBLE; };
+
+// Bytes of a plane in the file, padded so that the next plane is aligned.
+template<typename eT>
+u64 nativePlaneStride(const u32 height, const u32 width) {
+  const u64 bytes = (u64)height * width * sizeof(eT);
+  return (bytes + NATIVE_ALIGNMENT - 1) / NATIVE_ALIGNMENT * NATIVE_ALIGNMENT;
+}
+
+// Color space and planes of the images the native format holds.
+
+template<typename eT>
+s32 nativeColorSpace(const Image<eT>& image) {
+  return image.colorSpace();
+}
+
+template<typename eT>
+s32 nativeColorSpace(const Mat<eT>&) {
+  return NATIVE_GRAYSCALE;
+}
+
+template<typename eT>
+u32 nativePlanes(Image<eT>& image, Mat<eT>** planes) {
+  imagePlanes(image, planes[0], planes[1], planes[2]);
+  return 3;
+}
+
+template<typename eT>
+u32 nativePlanes(Mat<eT>& mat, Mat<eT>** planes) {
+  planes[0] = &mat;
+  return 1;
+}
+
+template<typename eT>
+void nativeSetSize(Image<eT>& image, const u32 height, const u32 width) {
+  image.height = height;
+  image.width = width;
+}
+
+template<typename eT>
+void nativeSetSize(Mat<eT>&, const u32, const u32) {
+}
+
+// Check the header of a mapped file against the image it is loaded into.
+template<typename eT>
+bool readNativeHeader(const MappedFile& file, const s32 colorSpace, const u32 planes, NativeHeader& header) {
+  if (file.size() < sizeof(NativeHeader))
+    return false;
+  memcpy(&header, file.data(), sizeof(NativeHeader));
+  if (memcmp(header.magic, NATIVE_MAGIC, sizeof(NATIVE_MAGIC)) != 0 ||
+      header.version != NATIVE_VERSION || header.byteOrder != NATIVE_BYTE_ORDER)
+    return false;
+  if (header.elemType != NativeElemTypeOf<eT>::value || header.elemSize != sizeof(eT) ||
+      header.colorSpace != colorSpace || header.planes != planes)
+    return false;
+  if (header.planeStride != nativePlaneStride<eT>(header.height, header.width))
+    return false;
+  return ((file.size() - sizeof(NativeHeader)) / planes >= header.planeStride);
+}
+
+template<typename eT>
+const eT* nativePlane(const MappedFile& file, const NativeHeader& header, const u32 plane) {
+  return (const eT*)(file.data() + sizeof(NativeHeader) + plane * header.planeStride);
+}
+
+template<typename eT>
+bool saveNativePlanes(const s32 colorSpace, Mat<eT>** planes, const u32 planeCount,
+                      const u32 height, const u32 width, const string& path) {
+  NativeHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, NATIVE_MAGIC, sizeof(NATIVE_MAGIC));
+  header.version = NATIVE_VERSION;
+  header.byteOrder = NATIVE_BYTE_ORDER;
+  header.elemType = NativeElemTypeOf<eT>::value;
+  header.elemSize = sizeof(eT);
+  header.colorSpace = colorSpace;
+  header.planes = planeCount;
+  header.height = height;
+  header.width = width;
+  header.planeStride = nativePlaneStride<eT>(height, width);
+
+  ofstream stream(path.c_str(), ios::binary | ios::trunc);
+  if (!stream)
+    return false;
+  stream.write((const char*)&header, sizeof(header));
+
+  const u64 bytes = (u64)height * width * sizeof(eT);
+  const char padding[NATIVE_ALIGNMENT] = {0};
+  for (u32 i = 0; i < planeCount; ++i) {
+    stream.write((const char*)planes[i]->memptr(), bytes);
+    stream.write(padding, header.planeStride - bytes);
+  }
+  stream.close();
+  return !stream.fail();
+}
+
+template<typename eT>
+bool loadNativePlanes(const s32 colorSpace, Mat<eT>** planes, const u32 planeCount,
+                      u32& height, u32& width, const string& path) {
+  MappedFile file;
+  NativeHeader header;
+  if (!file.open(path) || !readNativeHeader<eT>(file, colorSpace, planeCount, header))
+    return false;
+
+  height = header.height;
+  width = header.width;
+  for (u32 i = 0; i < planeCount; ++i) {
+    planes[i]->set_size(height, width);
+    memcpy(planes[i]->memptr(), nativePlane<eT>(file, header, i), (size_t)height * width * sizeof(eT));
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions to load and save images in the native format.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+bool saveNative(const Image<eT>& image, const string& path) {
+  if (!image.check())
+    throw logic_error("Inconsistent height and width in image");
+  Mat<eT>* planes[3];
+  const u32 planeCount = nativePlanes(const_cast<Image<eT>&>(image), planes);
+  return saveNativePlanes(nativeColorSpace(image), planes, planeCount, image.height, image.width, path);
+}
+
+template<typename eT>
+bool saveNative(const Mat<eT>& mat, const string& path) {
+  Mat<eT>* planes[1];
+  const u32 planeCount = nativePlanes(const_cast<Mat<eT>&>(mat), planes);
+  return saveNativePlanes(nativeColorSpace(mat), planes, planeCount, mat.n_rows, mat.n_cols, path);
+}
+
+template<typename eT>
+bool loadNative(Image<eT>& image, const string& path) {
+  Mat<eT>* planes[3];
+  const u32 planeCount = nativePlanes(image, planes);
+  u32 height, width;
+  if (!loadNativePlanes(nativeColorSpace(image), planes, planeCount, height, width, path))
+    return false;
+  nativeSetSize(image, height, width);
+  return true;
+}
+
+template<typename eT>
+bool loadNative(Mat<eT>& mat, const string& path) {
+  Mat<eT>* planes[1];
+  const u32 planeCount = nativePlanes(mat, planes);
+  u32 height, width;
+  return loadNativePlanes(nativeColorSpace(mat), planes, planeCount, height, width, path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedFile implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+inline MappedFile::MappedFile()
+  : mem(NULL), length(0) {
+}
+
+inline MappedFile::~MappedFile() {
+  close();
+}
+
+#ifdef _WIN32
+
+inline bool MappedFile::open(const string& path) {
+  close();
+  HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(handle);
+    return false;
+  }
+
+  // The view keeps the mapping, and the mapping the file, open.
+  HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(handle);
+  if (mapping == NULL)
+    return false;
+  void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == NULL)
+    return false;
+
+  mem = (u8*)view;
+  length = (uword)fileSize.QuadPart;
+  return true;
+}
+
+inline void MappedFile::close() {
+  if (mem != NULL)
+    UnmapViewOfFile(mem);
+  mem = NULL;
+  length = 0;
+}
+
+#else
+
+inline bool MappedFile::open(const string& path) {
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  // The mapping keeps the file open.
+  void* view = mmap(NULL, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return false;
+
+  mem = (u8*)view;
+  length = (uword)status.st_size;
+  return true;
+}
+
+inline void MappedFile::close() {
+  if (mem != NULL)
+    munmap(mem, length);
+  mem = NULL;
+  length = 0;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedImage implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class ImageT>
+bool MappedImage<ImageT>::open(const string& path) {
+  typedef typename ImageT::elem_type eT;
+  close();
+
+  Mat<eT>* planes[3];
+  const u32 planeCount = nativePlanes(data, planes);
+  NativeHeader header;
+  if (!file.open(path))
+    return false;
+  if (!readNativeHeader<eT>(file, nativeColorSpace(data), planeCount, header)) {
+    file.close();
+    return false;
+  }
+
+  for (u32 i = 0; i < planeCount; ++i)
+    aliasMemory(*planes[i], const_cast<eT*>(nativePlane<eT>(file, header, i)), header.height, header.width);
+  nativeSetSize(data, header.height, header.width);
+  return true;
+}
+
+template<class ImageT>
+void MappedImage<ImageT>::close() {
+  // Matrices over the mapping cannot be resized, so the image is constructed
+  // again before the file is unmapped.
+  data.~ImageT();
+  new (&data) ImageT();
+  file.close();
+}
+
+}  /* namespace sense */
+
+#endif  /* __NATIVE_IMPL_H__ */
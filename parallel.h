@@ -0,0 +1,108 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <armadillo>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel execution settings.
+////////////////////////////////////////////////////////////////////////////////
+
+// Conversions, grayscale conversion and thresholding can split an image into
+// bands and run the bands on a pool of threads. Each band is processed by the
+// same kernel as in the serial case, so the output does not depend on the
+// number of threads.
+
+// Set and get the number of threads used, the calling thread included. 1 (the
+// initial value) runs everything on the calling thread; 0 uses one thread per
+// hardware thread.
+
+void setThreadCount(const u32 count);
+
+u32 threadCount();
+
+// Set and get the smallest number of pixels given to a thread (initially
+// 65536). Images smaller than twice this are processed on the calling thread.
+
+void setMinTilePixels(const uword pixels);
+
+uword minTilePixels();
+
+// Smallest number of columns (or rows) of the given length given to a thread.
+
+uword minTileLines(const uword length);
+
+////////////////////////////////////////////////////////////////////////////////
+// Thread pool.
+////////////////////////////////////////////////////////////////////////////////
+
+// Pool of worker threads shared by all image operations. run() calls task(i)
+// for every i < tasks, spread over the workers and the calling thread, and
+// returns when all calls are done; the first exception thrown by a task is
+// rethrown. Calls from inside a task, and calls while another thread is using
+// the pool, are not nested into the pool: the former run on the calling
+// thread, the latter wait for their turn.
+
+class ThreadPool {
+  public:
+    static ThreadPool& instance();
+    ~ThreadPool();
+    void run(const u32 tasks, const u32 threads, const function<void(u32)>& task);
+  private:
+    ThreadPool();
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+    void work(u64 seen);
+    void participate(unique_lock<mutex>& guard, const u64 current);
+    static bool& insideTask();
+
+    mutex runLock;  // Held by the thread using the pool
+    mutex lock;  // Protects the members below
+    condition_variable wake;
+    condition_variable done;
+    vector<thread> workers;
+    const function<void(u32)>* job;
+    u32 taskCount;
+    u32 nextTask;
+    u32 pendingTasks;
+    u64 round;
+    exception_ptr error;
+    bool stopping;
+};
+
+// Split [0, count) into contiguous ranges of at least minCount elements, at
+// most one per thread, and call body(begin, end) for each of them in
+// parallel.
+
+template<typename Function>
+void parallelFor(const uword count, const uword minCount, const Function& body);
+
+// Number of workers parallelForEach() uses for count items: the thread count,
+// or 1 if there are fewer items than threads.
+
+u32 parallelWorkers(const uword count);
+
+// Call body(worker, i) for every i < count, handing the items out one at a
+// time to parallelWorkers(count) workers, so that items of different cost stay
+// balanced. worker (below parallelWorkers(count)) identifies the caller, for
+// scratch buffers kept per worker. With a single worker the items run on the
+// calling thread, where each of them can use the pool by itself.
+
+template<typename Function>
+void parallelForEach(const uword count, const Function& body);
+
+}  /* namespace sense */
+
+#include "parallel_impl.h"
+
+#endif  /* __PARALLEL_H__ */
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <atomic>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel execution settings.
+////////////////////////////////////////////////////////////////////////////////
+
+inline atomic<u32>& globalThreadCount() {
+  static atomic<u32> count(1);
+  return count;
+}
+
+inline atomic<uword>& globalMinTilePixels() {
+  static atomic<uword> pixels(65536);
+  return pixels;
+}
+
+inline void setThreadCount(const u32 count) {
+  const u32 hardware = std::max(thread::hardware_concurrency(), 1u);
+  globalThreadCount().store((count == 0) ? hardware : count, memory_order_relaxed);
+}
+
+inline u32 threadCount() {
+  return globalThreadCount().load(memory_order_relaxed);
+}
+
+inline void setMinTilePixels(const uword pixels) {
+  globalMinTilePixels().store(std::max(pixels, (uword)1), memory_order_relaxed);
+}
+
+inline uword minTilePixels() {
+  return globalMinTilePixels().load(memory_order_relaxed);
+}
+
+inline uword minTileLines(const uword length) {
+  return std::max(minTilePixels() / std::max(length, (uword)1), (uword)1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Thread pool implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+inline ThreadPool& ThreadPool::instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+inline ThreadPool::ThreadPool()
+  : job(NULL), taskCount(0), nextTask(0), pendingTasks(0), round(0), stopping(false) {
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+inline bool& ThreadPool::insideTask() {
+  static thread_local bool inside = false;
+  return inside;
+}
+
+inline void ThreadPool::run(const u32 tasks, const u32 threads, const function<void(u32)>& task) {
+  if (tasks <= 1 || threads <= 1 || insideTask()) {
+    for (u32 i = 0; i < tasks; i++)
+      task(i);
+    return;
+  }
+
+  lock_guard<mutex> runGuard(runLock);
+  unique_lock<mutex> guard(lock);
+  while (workers.size() + 1 < threads)
+    workers.push_back(thread(&ThreadPool::work, this, round));
+  job = &task;
+  taskCount = tasks;
+  nextTask = 0;
+  pendingTasks = tasks;
+  error = exception_ptr();
+  const u64 current = ++round;
+  wake.notify_all();
+
+  insideTask() = true;
+  participate(guard, current);
+  insideTask() = false;
+
+  done.wait(guard, [this] { return pendingTasks == 0; });
+  job = NULL;
+  if (error) {
+    exception_ptr rethrown = error;
+    error = exception_ptr();
+    rethrow_exception(rethrown);
+  }
+}
+
+// Take tasks of the given round until there are none left. Called with the
+// lock held.
+inline void ThreadPool::participate(unique_lock<mutex>& guard, const u64 current) {
+  while (round == current && nextTask < taskCount) {
+    const u32 i = nextTask++;
+    const function<void(u32)>& task = *job;
+    guard.unlock();
+    exception_ptr taskError;
+    try {
+      task(i);
+    }
+    catch (...) {
+      taskError = current_exception();
+    }
+    guard.lock();
+    if (taskError && !error)
+      error = taskError;
+    if (--pendingTasks == 0)
+      done.notify_all();
+  }
+}
+
+// Worker loop. seen is the round before the worker was started, so that it
+// joins the round that started it.
+inline void ThreadPool::work(u64 seen) {
+  insideTask() = true;
+  unique_lock<mutex> guard(lock);
+  while (true) {
+    wake.wait(guard, [this, &seen] { return stopping || round != seen; });
+    if (stopping)
+      return;
+    seen = round;
+    participate(guard, seen);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel loops.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename Function>
+void parallelFor(const uword count, const uword minCount, const Function& body) {
+  const uword bands = std::min((uword)threadCount(), count / std::max(minCount, (uword)1));
+  if (bands <= 1) {
+    if (count > 0)
+      body(0, count);
+    return;
+  }
+  ThreadPool::instance().run((u32)bands, (u32)bands, [&](const u32 band) {
+    body(count * band / bands, count * (band + 1) / bands);
+  });
+}
+
+inline u32 parallelWorkers(const uword count) {
+  const u32 threads = threadCount();
+  return (count < threads) ? 1 : threads;
+}
+
+template<typename Function>
+void parallelForEach(const uword count, const Function& body) {
+  const u32 workers = parallelWorkers(count);
+  if (workers <= 1) {
+    for (uword i = 0; i < count; i++)
+      body(0u, i);
+    return;
+  }
+  atomic<uword> next(0);
+  ThreadPool::instance().run(workers, workers, [&](const u32 worker) {
+    for (uword i = next++; i < count; i = next++)
+      body(worker, i);
+  });
+}
+
+}  /* namespace sense */
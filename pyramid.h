@@ -0,0 +1,100 @@
+#ifndef __PYRAMID_H__
+#define __PYRAMID_H__
+
+#include <armadillo>
+#include <vector>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Image pyramids.
+////////////////////////////////////////////////////////////////////////////////
+
+// Filters halving an octave into the next one.
+
+enum PyramidFilter {
+  PYRAMID_BOX = 0,  // Mean of 2x2 pixels
+  PYRAMID_GAUSSIAN = 1  // 5x5 binomial filter (1 4 6 4 1) / 16, edges repeated
+};
+
+// Multi-scale pyramid of an image, for detectors that scan the same image at
+// many sizes. ImageT is Mat<eT> or one of the color image classes.
+//
+// The pyramid has octaves octaves of scalesPerOctave levels each. Level
+// o * scalesPerOctave + s is scaled by about 2^-(o + s / scalesPerOctave)
+// from level 0, the image itself. The first level of each octave is built from the
+// first level of the previous octave with a 2x downsample (of height / 2 x
+// width / 2 pixels, rounded down); the other levels of an octave are resized
+// from its first level with RESIZE_AREA. Octaves that would be smaller than
+// 1 x 1 pixel are dropped.
+//
+// All levels live in one allocation, made by setup(), and are kept as long
+// as the geometry does not change, so building the pyramids of consecutive
+// frames of the same size does not allocate. build() copies a frame into
+// level 0 and, unless lazy is false, leaves the other levels to be built on
+// first access by level(), together with the levels they are built from.
+//
+// Levels are matrices (or images) over the allocation: they can be passed to
+// any function taking a const Mat<eT>& (or image), but not resized, and they
+// are valid until the next setup() changing the geometry or the destruction
+// of the pyramid. A pyramid must not be used by two threads at once.
+
+template<class ImageT>
+class Pyramid {
+  public:
+    typedef typename ImageT::elem_type elem_type;
+    Pyramid();
+
+    // Set the geometry of the pyramid for level 0 of height x width pixels.
+    // Nothing is reallocated if it does not change.
+    void setup(const u32 height, const u32 width, const u32 octaves,
+               const u32 scalesPerOctave = 1, const PyramidFilter filter = PYRAMID_GAUSSIAN);
+
+    // Copy image into level 0. Images of another size than the pyramid
+    // change its geometry, keeping the number of octaves and scales.
+    void build(const ImageT& image, const bool lazy = true);
+
+    // Build the level if needed and return it.
+    const ImageT& level(const u32 level);
+
+    bool isBuilt(const u32 level) const { return (built[level] != 0); }
+    u32 levels() const { return (u32)levelImages.size(); }
+    u32 octaves() const { return octaveCount; }
+    u32 scalesPerOctave() const { return scaleCount; }
+    u32 levelHeight(const u32 level) const { return heights[level]; }
+    u32 levelWidth(const u32 level) const { return widths[level]; }
+
+    // Actual scale of the level from level 0 along y and x: the sizes are
+    // rounded to whole pixels, so these differ from the nominal
+    // 2^-(level / scalesPerOctave) and from each other. Coordinates in the
+    // level are divided by them to map to level 0.
+    double levelScaleY(const u32 level) const;
+    double levelScaleX(const u32 level) const;
+  private:
+    typedef typename conditional<is_floating_point<elem_type>::value, elem_type, float>::type tT;
+    Pyramid(const Pyramid&);
+    Pyramid& operator=(const Pyramid&);
+
+    u32 octaveCount;
+    u32 requestedOctaves;
+    u32 scaleCount;
+    PyramidFilter filter;
+    vector<u32> heights;
+    vector<u32> widths;
+    vector<char> built;
+    vector<ImageT> levelImages;  // Over storage
+    Col<elem_type> storage;
+    Mat<tT> scratch;  // Input filtered across columns by the Gaussian downsample
+    Resizer<elem_type> resizer;
+};
+
+}  /* namespace sense */
+
+#include "pyramid_impl.h"
+
+#endif  /* __PYRAMID_H__ */
@@ -0,0 +1,270 @@
+#ifndef __PYRAMID_IMPL_H__
+#define __PYRAMID_IMPL_H__
+
+#include <algorithm>
+#include <cmath>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Planes and size of the images a pyramid holds.
+
+template<class ImageT>
+struct PyramidPlaneCount {
+  static const u32 value = IsColorImage<ImageT>::value ? 3 : 1;
+};
+
+template<typename eT>
+void pyramidPlanes(Mat<eT>& mat, Mat<eT>** planes) {
+  planes[0] = &mat;
+}
+
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value>::type
+pyramidPlanes(ImageT& image, Mat<typename ImageT::elem_type>** planes) {
+  imagePlanes(image, planes[0], planes[1], planes[2]);
+}
+
+template<typename eT>
+void pyramidSize(const Mat<eT>& mat, u32& height, u32& width) {
+  height = mat.n_rows;
+  width = mat.n_cols;
+}
+
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value>::type
+pyramidSize(const ImageT& image, u32& height, u32& width) {
+  if (!image.check())
+    throw logic_error("Inconsistent height and width in image");
+  height = image.height;
+  width = image.width;
+}
+
+template<typename eT>
+void pyramidSetSize(Mat<eT>&, const u32, const u32) {
+}
+
+template<class ImageT>
+typename enable_if<IsColorImage<ImageT>::value>::type
+pyramidSetSize(ImageT& image, const u32 height, const u32 width) {
+  image.height = height;
+  image.width = width;
+}
+
+// Halve a plane of inHeight rows by averaging 2x2 pixels. Odd last rows and
+// columns are dropped.
+template<typename tT, typename eT>
+void downsampleBox(eT* out, const u32 outHeight, const u32 outWidth, const eT* in, const u32 inHeight) {
+  parallelFor(outWidth, minTileLines(inHeight), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++) {
+      const eT* SENSE_RESTRICT in0 = in + 2 * x * inHeight;
+      const eT* SENSE_RESTRICT in1 = in0 + inHeight;
+      eT* SENSE_RESTRICT outColumn = out + x * outHeight;
+      for (u32 y = 0; y < outHeight; y++) {
+        const tT sum = (tT)in0[2 * y] + (tT)in0[2 * y + 1] + (tT)in1[2 * y] + (tT)in1[2 * y + 1];
+        outColumn[y] = saturateCast<eT>(sum * (tT)0.25);
+      }
+    }
+  });
+}
+
+// Halve a plane of inHeight x inWidth pixels with the 5x5 binomial filter,
+// repeating the edges. Each output column is first filtered across the
+// input columns into scratch (inHeight x outWidth), where the inner loop runs
+// down whole columns, and then filtered and decimated down the column.
+template<typename tT, typename eT>
+void downsampleGaussian(eT* out, const u32 outHeight, const u32 outWidth,
+                        const eT* in, const u32 inHeight, const u32 inWidth, tT* scratch) {
+  const tT w0 = (tT)0.0625;
+  const tT w1 = (tT)0.25;
+  const tT w2 = (tT)0.375;
+  const auto column = [&](const s64 x) {
+    return in + (uword)std::min(std::max(x, (s64)0), (s64)inWidth - 1) * inHeight;
+  };
+  parallelFor(outWidth, minTileLines(inHeight), [&](const uword begin, const uword end) {
+    for (uword x = begin; x < end; x++) {
+      const eT* SENSE_RESTRICT c0 = column(2 * (s64)x - 2);
+      const eT* SENSE_RESTRICT c1 = column(2 * (s64)x - 1);
+      const eT* SENSE_RESTRICT c2 = column(2 * (s64)x);
+      const eT* SENSE_RESTRICT c3 = column(2 * (s64)x + 1);
+      const eT* SENSE_RESTRICT c4 = column(2 * (s64)x + 2);
+      tT* SENSE_RESTRICT rows = scratch + x * inHeight;
+      for (u32 y = 0; y < inHeight; y++)
+        rows[y] = w0 * ((tT)c0[y] + (tT)c4[y]) + w1 * ((tT)c1[y] + (tT)c3[y]) + w2 * (tT)c2[y];
+
+      eT* SENSE_RESTRICT outColumn = out + x * outHeight;
+      const s64 last = (s64)inHeight - 1;
+      for (u32 y = 0; y < outHeight; y++) {
+        const s64 center = 2 * (s64)y;
+        tT sum;
+        if (center >= 2 && center + 2 <= last) {
+          sum = w0 * (rows[center - 2] + rows[center + 2]) + w1 * (rows[center - 1] + rows[center + 1]) +
+                w2 * rows[center];
+        }
+        else {
+          const auto row = [&](const s64 i) { return rows[std::min(std::max(i, (s64)0), last)]; };
+          sum = w0 * (row(center - 2) + row(center + 2)) + w1 * (row(center - 1) + row(center + 1)) +
+                w2 * row(center);
+        }
+        outColumn[y] = saturateCast<eT>(sum);
+      }
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pyramid implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class ImageT>
+Pyramid<ImageT>::Pyramid()
+  : octaveCount(0), requestedOctaves(1), scaleCount(1), filter(PYRAMID_GAUSSIAN) {
+}
+
+template<class ImageT>
+void Pyramid<ImageT>::setup(const u32 height, const u32 width, const u32 octaves,
+                            const u32 scalesPerOctave /* default: 1 */,
+                            const PyramidFilter filter /* default: PYRAMID_GAUSSIAN */) {
+  if (octaves == 0 || scalesPerOctave == 0)
+    throw logic_error("Pyramids need at least one octave and one scale per octave");
+  if (filter != PYRAMID_BOX && filter != PYRAMID_GAUSSIAN)
+    throw logic_error("Unknown pyramid filter");
+
+  // Sizes of the levels.
+  vector<u32> newHeights;
+  vector<u32> newWidths;
+  u32 octaveHeight = height;
+  u32 octaveWidth = width;
+  for (u32 o = 0; o < octaves; o++) {
+    if (o > 0) {
+      if (octaveHeight < 2 || octaveWidth < 2)
+        break;
+      octaveHeight /= 2;
+      octaveWidth /= 2;
+    }
+    for (u32 s = 0; s < scalesPerOctave; s++) {
+      const double scale = pow(2.0, -(double)s / scalesPerOctave);
+      newHeights.push_back(std::min(std::max((u32)floor(octaveHeight * scale + 0.5), (u32)1), octaveHeight));
+      newWidths.push_back(std::min(std::max((u32)floor(octaveWidth * scale + 0.5), (u32)1), octaveWidth));
+    }
+  }
+
+  requestedOctaves = octaves;
+  if (filter != this->filter) {
+    for (uword i = 1; i < built.size(); i++)
+      built[i] = 0;
+  }
+  this->filter = filter;
+  if (newHeights == heights && newWidths == widths && scalesPerOctave == scaleCount)
+    return;
+
+  heights.swap(newHeights);
+  widths.swap(newWidths);
+  scaleCount = scalesPerOctave;
+  octaveCount = (u32)heights.size() / scaleCount;
+
+  // One allocation for all planes of all levels.
+  const u32 planeCount = PyramidPlaneCount<ImageT>::value;
+  uword total = 0;
+  for (uword i = 0; i < heights.size(); i++)
+    total += (uword)planeCount * heights[i] * widths[i];
+  storage.set_size(total);
+
+  levelImages.clear();
+  levelImages.resize(heights.size());
+  elem_type* mem = storage.memptr();
+  for (uword i = 0; i < heights.size(); i++) {
+    Mat<elem_type>* planes[3];
+    pyramidPlanes(levelImages[i], planes);
+    for (u32 p = 0; p < planeCount; p++) {
+      aliasMemory(*planes[p], mem, heights[i], widths[i]);
+      mem += (uword)heights[i] * widths[i];
+    }
+    pyramidSetSize(levelImages[i], heights[i], widths[i]);
+  }
+  built.assign(heights.size(), 0);
+
+  // The Gaussian downsample of level 0 needs the largest scratch plane.
+  if (octaveCount > 1)
+    scratch.set_size(heights[0], widths[scaleCount]);
+  else
+    scratch.reset();
+}
+
+template<class ImageT>
+void Pyramid<ImageT>::build(const ImageT& image, const bool lazy /* default: true */) {
+  u32 height, width;
+  pyramidSize(image, height, width);
+  if (heights.empty() || height != heights[0] || width != widths[0])
+    setup(height, width, requestedOctaves, scaleCount, filter);
+
+  const u32 planeCount = PyramidPlaneCount<ImageT>::value;
+  Mat<elem_type>* planesIn[3];
+  Mat<elem_type>* planesOut[3];
+  pyramidPlanes(const_cast<ImageT&>(image), planesIn);
+  pyramidPlanes(levelImages[0], planesOut);
+  for (u32 p = 0; p < planeCount; p++)
+    std::copy(planesIn[p]->memptr(), planesIn[p]->memptr() + (uword)height * width, planesOut[p]->memptr());
+
+  built.assign(built.size(), 0);
+  built[0] = 1;
+  if (!lazy) {
+    for (u32 i = 1; i < levels(); i++)
+      level(i);
+  }
+}
+
+template<class ImageT>
+const ImageT& Pyramid<ImageT>::level(const u32 level) {
+  if (level >= levels())
+    throw logic_error("Level outside the pyramid");
+  if (built[level])
+    return levelImages[level];
+  if (level == 0)
+    throw logic_error("Pyramid built without an image");
+
+  // Levels are built from the first level of their octave, or of the
+  // previous octave for the first level of an octave.
+  const u32 s = level % scaleCount;
+  const u32 source = (s == 0) ? level - scaleCount : level - s;
+  this->level(source);
+
+  const u32 planeCount = PyramidPlaneCount<ImageT>::value;
+  Mat<elem_type>* planesIn[3];
+  Mat<elem_type>* planesOut[3];
+  pyramidPlanes(levelImages[source], planesIn);
+  pyramidPlanes(levelImages[level], planesOut);
+  const u32 inHeight = heights[source];
+  const u32 inWidth = widths[source];
+  const u32 outHeight = heights[level];
+  const u32 outWidth = widths[level];
+  for (u32 p = 0; p < planeCount; p++) {
+    elem_type* out = planesOut[p]->memptr();
+    const elem_type* in = planesIn[p]->memptr();
+    if (s != 0)
+      resizer.resize(out, outHeight, in, inHeight, inHeight, inWidth, outHeight, outWidth, RESIZE_AREA);
+    else if (filter == PYRAMID_BOX)
+      downsampleBox<tT>(out, outHeight, outWidth, in, inHeight);
+    else
+      downsampleGaussian<tT>(out, outHeight, outWidth, in, inHeight, inWidth, scratch.memptr());
+  }
+  built[level] = 1;
+  return levelImages[level];
+}
+
+template<class ImageT>
+double Pyramid<ImageT>::levelScaleY(const u32 level) const {
+  return (double)heights[level] / heights[0];
+}
+
+template<class ImageT>
+double Pyramid<ImageT>::levelScaleX(const u32 level) const {
+  return (double)widths[level] / widths[0];
+}
+
+}  /* namespace sense */
+
+#endif  /* __PYRAMID_IMPL_H__ */
@@ -0,0 +1,94 @@
+#ifndef __RESAMPLE_H__
+#define __RESAMPLE_H__
+
+#include <armadillo>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace arma;
+
+// Pointer qualifier telling the compiler that buffers do not overlap, so that
+// the inner loops of the pixel kernels can be vectorized.
+#if defined(__GNUC__) || defined(__clang__)
+#define SENSE_RESTRICT __restrict__
+#elif defined(_MSC_VER)
+#define SENSE_RESTRICT __restrict
+#else
+#define SENSE_RESTRICT
+#endif
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Resampling filters.
+////////////////////////////////////////////////////////////////////////////////
+
+enum ResizeFilter {
+  RESIZE_NEAREST = 0,
+  RESIZE_BILINEAR = 1,
+  RESIZE_AREA = 2,  // Pixel area averaging
+  RESIZE_LANCZOS = 3  // Lanczos-3
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Resampling classes.
+////////////////////////////////////////////////////////////////////////////////
+
+// Precomputed weights of a one-dimensional resampling filter. Output sample i
+// is the sum over k < taps of weights[i * taps + k] * input[first[i] + k].
+// Every window lies inside the input, so no bounds checks are needed when the
+// weights are applied.
+
+template<typename wT>
+class ResizeKernel {
+  public:
+    u32 inSize;
+    u32 outSize;
+    u32 taps;
+    ResizeFilter filter;
+    vector<u32> first;
+    vector<wT> weights;
+    ResizeKernel() : inSize(0), outSize(0), taps(0), filter(RESIZE_NEAREST) {}
+    void setup(const u32 newInSize, const u32 newOutSize, const ResizeFilter newFilter);
+    bool isIdentity() const;
+};
+
+// Separable resampling engine working directly on Armadillo planes. The image
+// is resampled along one axis into a scratch plane and then along the other;
+// the cheaper of the two orders is chosen from the filter sizes. Kernels and
+// the scratch plane are kept between calls, so resizing many planes of the
+// same size (e.g. the three planes of an ImageRGB, or consecutive frames)
+// neither recomputes weights nor reallocates.
+//
+// resizeInterleaved() resamples row-major images with interleaved channels,
+// such as ImagePacked data.
+//
+// Integer planes are accumulated in float and rounded and saturated on
+// output; floating-point planes are accumulated in their own type and are not
+// clamped.
+
+template<typename eT>
+class Resizer {
+  public:
+    typedef typename conditional<is_floating_point<eT>::value, eT, float>::type tT;
+    void resize(Mat<eT>& matOut, const Mat<eT>& matIn,
+                const u32 height, const u32 width, const ResizeFilter filter);
+    void resize(eT* out, const uword outStride, const eT* in, const uword inStride,
+                const u32 inHeight, const u32 inWidth, const u32 height, const u32 width,
+                const ResizeFilter filter);
+    void resizeInterleaved(eT* out, const eT* in, const u32 inHeight, const u32 inWidth,
+                           const u32 height, const u32 width, const u32 channels,
+                           const ResizeFilter filter);
+  private:
+    ResizeKernel<tT> yKernel;
+    ResizeKernel<tT> xKernel;
+    Mat<tT> scratch;
+    vector<tT> accumulator;
+};
+
+}  /* namespace sense */
+
+#include "resample_impl.h"
+
+#endif  /* __RESAMPLE_H__ */
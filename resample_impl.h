@@ -0,0 +1,314 @@
+#ifndef __RESAMPLE_IMPL_H__
+#define __RESAMPLE_IMPL_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Convert a sample to the element type of an image. Integer types are rounded
+// to nearest and saturated to their range; floating-point types are cast.
+template<typename oT, typename iT>
+inline typename enable_if<is_floating_point<oT>::value, oT>::type
+saturateCast(const iT value) {
+  return (oT)value;
+}
+
+template<typename oT, typename iT>
+inline typename enable_if<is_integral<oT>::value, oT>::type
+saturateCast(const iT value) {
+  if (value <= (iT)numeric_limits<oT>::min())
+    return numeric_limits<oT>::min();
+  if (value >= (iT)numeric_limits<oT>::max())
+    return numeric_limits<oT>::max();
+  return (oT)floor(value + (iT)0.5);
+}
+
+inline double sinc(const double x) {
+  if (x == 0.0)
+    return 1.0;
+  const double piX = datum::pi * x;
+  return sin(piX) / piX;
+}
+
+// Filter response at distance x (in input samples) from the output sample.
+inline double filterResponse(const ResizeFilter filter, const double x) {
+  switch (filter) {
+    case RESIZE_BILINEAR:
+      return std::max(0.0, 1.0 - fabs(x));
+    case RESIZE_LANCZOS:
+      return (fabs(x) < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+    default:
+      throw logic_error("Filter has no continuous response");
+  }
+}
+
+inline double filterSupport(const ResizeFilter filter) {
+  switch (filter) {
+    case RESIZE_BILINEAR:
+      return 1.0;
+    case RESIZE_LANCZOS:
+      return 3.0;
+    default:
+      throw logic_error("Filter has no continuous response");
+  }
+}
+
+// Resample each of lines lines along its own length. Line l of the input
+// starts at in + l * inLineStride and its samples are inStep apart; the
+// output is laid out the same way with outStep and outLineStride.
+template<typename oT, typename iT, typename wT>
+void resampleAlong(oT* out, const uword outStep, const uword outLineStride,
+                   const iT* in, const uword inStep, const uword inLineStride,
+                   const uword lines, const ResizeKernel<wT>& kernel) {
+  const u32 taps = kernel.taps;
+  const u32* first = &kernel.first[0];
+  for (uword l = 0; l < lines; l++) {
+    const iT* SENSE_RESTRICT inLine = in + l * inLineStride;
+    oT* SENSE_RESTRICT outLine = out + l * outLineStride;
+    const wT* SENSE_RESTRICT weights = &kernel.weights[0];
+    for (u32 i = 0; i < kernel.outSize; i++, weights += taps) {
+      const iT* SENSE_RESTRICT window = inLine + first[i] * inStep;
+      wT sum = 0;
+      for (u32 k = 0; k < taps; k++)
+        sum += weights[k] * (wT)window[k * inStep];
+      outLine[i * outStep] = saturateCast<oT>(sum);
+    }
+  }
+}
+
+// Resample across lines: output line i is the weighted sum of input lines
+// first[i] ... first[i] + taps - 1. Each line holds length contiguous samples,
+// so the inner loop is a vectorizable multiply-add over whole lines.
+template<typename oT, typename iT, typename wT>
+void resampleAcross(oT* out, const uword outLineStride,
+                    const iT* in, const uword inLineStride,
+                    const uword length, const ResizeKernel<wT>& kernel,
+                    vector<wT>& accumulator) {
+  accumulator.resize(length);
+  wT* SENSE_RESTRICT sum = &accumulator[0];
+  const u32 taps = kernel.taps;
+  for (u32 i = 0; i < kernel.outSize; i++) {
+    const wT* weights = &kernel.weights[i * taps];
+    const iT* SENSE_RESTRICT inLine = in + kernel.first[i] * inLineStride;
+    const wT weight0 = weights[0];
+    for (uword j = 0; j < length; j++)
+      sum[j] = weight0 * (wT)inLine[j];
+    for (u32 k = 1; k < taps; k++) {
+      const wT weight = weights[k];
+      if (weight == 0)
+        continue;
+      const iT* SENSE_RESTRICT tapLine = in + (kernel.first[i] + k) * inLineStride;
+      for (uword j = 0; j < length; j++)
+        sum[j] += weight * (wT)tapLine[j];
+    }
+    oT* SENSE_RESTRICT outLine = out + i * outLineStride;
+    for (uword j = 0; j < length; j++)
+      outLine[j] = saturateCast<oT>(sum[j]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ResizeKernel implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename wT>
+void ResizeKernel<wT>::setup(const u32 newInSize, const u32 newOutSize, const ResizeFilter newFilter) {
+  if (newInSize == 0 || newOutSize == 0)
+    throw logic_error("Cannot resample to or from zero samples");
+
+  // Keep the weights of the previous call when nothing changed.
+  if (newInSize == inSize && newOutSize == outSize && newFilter == filter && !first.empty())
+    return;
+
+  inSize  = newInSize;
+  outSize = newOutSize;
+  filter  = newFilter;
+  first.resize(outSize);
+
+  const double scale = (double)inSize / outSize;
+
+  if (filter == RESIZE_NEAREST) {
+    taps = 1;
+    weights.assign(outSize, (wT)1);
+    for (u32 i = 0; i < outSize; i++)
+      first[i] = std::min((u32)((i + 0.5) * scale), inSize - 1);
+    return;
+  }
+
+  // Compute the window [begin, begin + count) and the normalized weights of
+  // each output sample. When shrinking, the filter is stretched by the scale
+  // factor so that it also acts as an anti-aliasing filter.
+  vector<u32> begin(outSize);
+  vector<u32> count(outSize);
+  vector<vector<double> > windowWeights(outSize);
+  u32 maxCount = 1;
+  for (u32 i = 0; i < outSize; i++) {
+    u32 xMin, xMax;
+    vector<double>& w = windowWeights[i];
+    if (filter == RESIZE_AREA) {
+      // Weight each input sample by its overlap with the footprint of the
+      // output sample.
+      const double footprintBegin = i * scale;
+      const double footprintEnd   = (i + 1) * scale;
+      xMin = std::min((u32)floor(footprintBegin), inSize - 1);
+      xMax = std::min((u32)ceil(footprintEnd), inSize);
+      if (xMax <= xMin)
+        xMax = xMin + 1;
+      for (u32 x = xMin; x < xMax; x++)
+        w.push_back(std::max(0.0, std::min<double>(x + 1, footprintEnd) - std::max<double>(x, footprintBegin)));
+    }
+    else {
+      const double filterScale = std::max(scale, 1.0);
+      const double support = filterSupport(filter) * filterScale;
+      const double center = (i + 0.5) * scale;
+      xMin = (u32)std::max(0.0, floor(center - support + 0.5));
+      xMax = (u32)std::min<double>(inSize, floor(center + support + 0.5));
+      if (xMax <= xMin) {
+        xMin = std::min(xMin, inSize - 1);
+        xMax = xMin + 1;
+      }
+      for (u32 x = xMin; x < xMax; x++)
+        w.push_back(filterResponse(filter, (x - center + 0.5) / filterScale));
+    }
+
+    double total = 0;
+    for (u32 k = 0; k < w.size(); k++)
+      total += w[k];
+    if (total == 0) {
+      // Degenerate window: fall back to the nearest input sample.
+      w.assign(w.size(), 0.0);
+      const u32 nearest = (u32)((i + 0.5) * scale);
+      w[std::min(std::max(nearest, xMin), xMax - 1) - xMin] = 1.0;
+      total = 1.0;
+    }
+    for (u32 k = 0; k < w.size(); k++)
+      w[k] /= total;
+
+    begin[i] = xMin;
+    count[i] = xMax - xMin;
+    maxCount = std::max(maxCount, count[i]);
+  }
+
+  // Pad all windows to the same number of taps. Windows near the end of the
+  // input are shifted left so that they never read past it.
+  taps = maxCount;
+  weights.assign((size_t)outSize * taps, (wT)0);
+  for (u32 i = 0; i < outSize; i++) {
+    first[i] = std::min(begin[i], inSize - taps);
+    const u32 offset = begin[i] - first[i];
+    for (u32 k = 0; k < count[i]; k++)
+      weights[(size_t)i * taps + offset + k] = (wT)windowWeights[i][k];
+  }
+}
+
+template<typename wT>
+bool ResizeKernel<wT>::isIdentity() const {
+  return (inSize == outSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Resizer implementation.
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename eT>
+void Resizer<eT>::resize(Mat<eT>& matOut, const Mat<eT>& matIn,
+                         const u32 height, const u32 width, const ResizeFilter filter) {
+  if (&matOut == &matIn) {
+    const Mat<eT> matCopy(matIn);
+    resize(matOut, matCopy, height, width, filter);
+    return;
+  }
+  matOut.set_size(height, width);
+  resize(matOut.memptr(), height, matIn.memptr(), matIn.n_rows,
+         matIn.n_rows, matIn.n_cols, height, width, filter);
+}
+
+template<typename eT>
+void Resizer<eT>::resize(eT* out, const uword outStride, const eT* in, const uword inStride,
+                         const u32 inHeight, const u32 inWidth, const u32 height, const u32 width,
+                         const ResizeFilter filter) {
+  yKernel.setup(inHeight, height, filter);
+  xKernel.setup(inWidth, width, filter);
+
+  if (yKernel.isIdentity() && xKernel.isIdentity()) {
+    for (u32 x = 0; x < width; x++)
+      std::copy(in + x * inStride, in + x * inStride + height, out + x * outStride);
+    return;
+  }
+  if (yKernel.isIdentity()) {
+    resampleAcross(out, outStride, in, inStride, height, xKernel, accumulator);
+    return;
+  }
+  if (xKernel.isIdentity()) {
+    resampleAlong(out, 1, outStride, in, 1, inStride, width, yKernel);
+    return;
+  }
+
+  // Resample first along the axis that makes the whole job cheaper.
+  const double yFirstCost = (double)inWidth * height * yKernel.taps + (double)height * width * xKernel.taps;
+  const double xFirstCost = (double)inHeight * width * xKernel.taps + (double)height * width * yKernel.taps;
+  if (yFirstCost <= xFirstCost) {
+    scratch.set_size(height, inWidth);
+    resampleAlong(scratch.memptr(), 1, height, in, 1, inStride, inWidth, yKernel);
+    resampleAcross(out, outStride, scratch.memptr(), height, height, xKernel, accumulator);
+  }
+  else {
+    scratch.set_size(inHeight, width);
+    resampleAcross(scratch.memptr(), inHeight, in, inStride, inHeight, xKernel, accumulator);
+    resampleAlong(out, 1, outStride, scratch.memptr(), 1, inHeight, width, yKernel);
+  }
+}
+
+template<typename eT>
+void Resizer<eT>::resizeInterleaved(eT* out, const eT* in, const u32 inHeight, const u32 inWidth,
+                                    const u32 height, const u32 width, const u32 channels,
+                                    const ResizeFilter filter) {
+  yKernel.setup(inHeight, height, filter);
+  xKernel.setup(inWidth, width, filter);
+
+  // Rows are contiguous, so the roles of the two passes are swapped with
+  // respect to column-major planes: rows are resampled across each other, and
+  // each channel is resampled along the row with a step of channels.
+  const uword inRowStride  = (uword)inWidth * channels;
+  const uword outRowStride = (uword)width * channels;
+
+  if (yKernel.isIdentity() && xKernel.isIdentity()) {
+    std::copy(in, in + inRowStride * inHeight, out);
+    return;
+  }
+  if (xKernel.isIdentity()) {
+    resampleAcross(out, outRowStride, in, inRowStride, outRowStride, yKernel, accumulator);
+    return;
+  }
+  if (yKernel.isIdentity()) {
+    for (u32 c = 0; c < channels; c++)
+      resampleAlong(out + c, channels, outRowStride, in + c, channels, inRowStride, inHeight, xKernel);
+    return;
+  }
+
+  const double yFirstCost = (double)inWidth * height * yKernel.taps + (double)height * width * xKernel.taps;
+  const double xFirstCost = (double)inHeight * width * xKernel.taps + (double)height * width * yKernel.taps;
+  if (yFirstCost <= xFirstCost) {
+    scratch.set_size(inRowStride, height);
+    resampleAcross(scratch.memptr(), inRowStride, in, inRowStride, inRowStride, yKernel, accumulator);
+    for (u32 c = 0; c < channels; c++)
+      resampleAlong(out + c, channels, outRowStride, scratch.memptr() + c, channels, inRowStride, height, xKernel);
+  }
+  else {
+    scratch.set_size(outRowStride, inHeight);
+    for (u32 c = 0; c < channels; c++)
+      resampleAlong(scratch.memptr() + c, channels, outRowStride, in + c, channels, inRowStride, inHeight, xKernel);
+    resampleAcross(out, outRowStride, scratch.memptr(), outRowStride, outRowStride, yKernel, accumulator);
+  }
+}
+
+}  /* namespace sense */
+
+#endif  /* __RESAMPLE_IMPL_H__ */
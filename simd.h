@@ -0,0 +1,109 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <atomic>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// Compiler support.
+////////////////////////////////////////////////////////////////////////////////
+
+// Runtime dispatch needs GCC or Clang on x86: kernels are compiled once per
+// instruction set with the target attribute and picked with
+// __builtin_cpu_supports(). Elsewhere only the scalar kernels are built.
+//
+// GCC only vectorizes cheap loops at -O2, so the kernels ask for the full
+// vectorizer. FMA contraction is turned off (AVX-512F implies FMA), so that
+// every instruction set rounds like the scalar code; with Clang, build with
+// -ffp-contract=off for the same guarantee. Build with -fno-trapping-math as
+// well: otherwise GCC keeps some selects of the HSV kernels as branches and
+// leaves those loops scalar.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SENSE_SIMD_DISPATCH 1
+#if defined(__clang__)
+#define SENSE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SENSE_TARGET(isa) __attribute__((target(isa), optimize("tree-vectorize", "vect-cost-model=dynamic", \
+                                                               "fp-contract=off")))
+#endif
+#endif
+
+// Force inlining of per-pixel functions, so that they are compiled for the
+// instruction set of the kernel calling them.
+#if defined(__GNUC__) || defined(__clang__)
+#define SENSE_FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define SENSE_FORCE_INLINE __forceinline
+#else
+#define SENSE_FORCE_INLINE inline
+#endif
+
+// Tell the vectorizer that the iterations of the next loop are independent.
+// Kernels may run in place (output plane equal to input plane), which is
+// safe since every pixel is read before it is written.
+#if defined(__clang__)
+#define SENSE_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define SENSE_IVDEP _Pragma("GCC ivdep")
+#else
+#define SENSE_IVDEP
+#endif
+
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Instruction sets.
+////////////////////////////////////////////////////////////////////////////////
+
+// Kernels are written without branches in their inner loops, so that they
+// vectorize, and compiled for each of these instruction sets. The results do
+// not depend on the instruction set.
+
+enum SimdLevel {
+  SIMD_SCALAR = 0,  // Baseline of the build
+  SIMD_SSE42 = 1,
+  SIMD_AVX2 = 2,
+  SIMD_AVX512 = 3  // AVX-512F
+};
+
+// Best instruction set supported by both the CPU and the build.
+
+SimdLevel supportedSimdLevel();
+
+// Set and get the instruction set used by kernels. Levels above
+// supportedSimdLevel() are lowered to it; SIMD_SCALAR forces the scalar
+// kernels.
+
+void setSimdLevel(const SimdLevel level);
+
+SimdLevel simdLevel();
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel dispatch.
+////////////////////////////////////////////////////////////////////////////////
+
+// Versions of a kernel compiled for each instruction set. Kernel provides the
+// function pointer type Function and a static, force-inlined run() with that
+// signature; select() returns the version for simdLevel().
+
+template<class Kernel, typename Function = typename Kernel::Function>
+struct SimdKernel;
+
+template<class Kernel, typename... Args>
+struct SimdKernel<Kernel, void (*)(Args...)> {
+  typedef void (*Function)(Args...);
+  static void scalar(Args... args);
+#ifdef SENSE_SIMD_DISPATCH
+  SENSE_TARGET("sse4.2") static void sse42(Args... args);
+  SENSE_TARGET("avx2") static void avx2(Args... args);
+  SENSE_TARGET("avx512f") static void avx512(Args... args);
+#endif
+  static Function select();
+};
+
+}  /* namespace sense */
+
+#include "simd_impl.h"
+
+#endif  /* __SIMD_H__ */
@@ -0,0 +1,76 @@
+namespace sense {
+
+////////////////////////////////////////////////////////////////////////////////
+// Instruction sets.
+////////////////////////////////////////////////////////////////////////////////
+
+inline SimdLevel detectSimdLevel() {
+#ifdef SENSE_SIMD_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2"))    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.2"))  return SIMD_SSE42;
+#endif
+  return SIMD_SCALAR;
+}
+
+inline SimdLevel supportedSimdLevel() {
+  static const SimdLevel level = detectSimdLevel();
+  return level;
+}
+
+inline atomic<int>& globalSimdLevel() {
+  static atomic<int> level(supportedSimdLevel());
+  return level;
+}
+
+inline void setSimdLevel(const SimdLevel level) {
+  const SimdLevel supported = supportedSimdLevel();
+  globalSimdLevel().store((level < supported) ? level : supported, memory_order_relaxed);
+}
+
+inline SimdLevel simdLevel() {
+  return (SimdLevel)globalSimdLevel().load(memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernel dispatch.
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Kernel, typename... Args>
+void SimdKernel<Kernel, void (*)(Args...)>::scalar(Args... args) {
+  Kernel::run(args...);
+}
+
+#ifdef SENSE_SIMD_DISPATCH
+
+template<class Kernel, typename... Args>
+SENSE_TARGET("sse4.2") void SimdKernel<Kernel, void (*)(Args...)>::sse42(Args... args) {
+  Kernel::run(args...);
+}
+
+template<class Kernel, typename... Args>
+SENSE_TARGET("avx2") void SimdKernel<Kernel, void (*)(Args...)>::avx2(Args... args) {
+  Kernel::run(args...);
+}
+
+template<class Kernel, typename... Args>
+SENSE_TARGET("avx512f") void SimdKernel<Kernel, void (*)(Args...)>::avx512(Args... args) {
+  Kernel::run(args...);
+}
+
+#endif
+
+template<class Kernel, typename... Args>
+typename SimdKernel<Kernel, void (*)(Args...)>::Function SimdKernel<Kernel, void (*)(Args...)>::select() {
+  switch (simdLevel()) {
+#ifdef SENSE_SIMD_DISPATCH
+    case SIMD_AVX512: return &avx512;
+    case SIMD_AVX2:   return &avx2;
+    case SIMD_SSE42:  return &sse42;
+#endif
+    default:          return &scalar;
+  }
+}
+
+}  /* namespace sense */
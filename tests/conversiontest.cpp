@@ -0,0 +1,249 @@
+// Checks of the conversion, grayscale and threshold functions of image.h:
+// results must not depend on the number of threads or on the instruction set,
+// and integer images must stay close to the floating-point conversions.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+using namespace std;
+using namespace arma;
+using namespace sense;
+
+static int failures = 0;
+
+static void check(const bool condition, const string& what) {
+  if (!condition) {
+    cerr << "FAIL: " << what << endl;
+    failures++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Helper functions.
+////////////////////////////////////////////////////////////////////////////////
+
+// Random image of height x width pixels in 0 - 255, with whole values for
+// integer images, and grays (including black and white) in the first column
+// so that the special cases of the conversions are covered.
+template<typename eT>
+ImageRGB<eT> randomImage(const u32 height, const u32 width, const u32 seed) {
+  mt19937 generator(seed);
+  uniform_real_distribution<double> distribution(0, 255);
+  ImageRGB<eT> image(height, width);
+  for (uword i = 0; i < image.r.n_elem; i++) {
+    image.r[i] = (eT)distribution(generator);
+    image.g[i] = (eT)distribution(generator);
+    image.b[i] = (eT)distribution(generator);
+  }
+  for (u32 y = 0; y < height; y++)
+    image.r(y, 0) = image.g(y, 0) = image.b(y, 0) = (eT)(y % 256);
+  return image;
+}
+
+template<typename eT>
+void addPlanes(vector<Mat<eT> >& planes, Image<eT>& image) {
+  Mat<eT>* plane[3];
+  imagePlanes(image, plane[0], plane[1], plane[2]);
+  for (u32 p = 0; p < 3; p++)
+    planes.push_back(*plane[p]);
+}
+
+// Outputs of every conversion of the image and of a region of it, of the
+// grayscale conversion and of thresholding.
+template<typename eT>
+vector<Mat<eT> > convertAll(const ImageRGB<eT>& image) {
+  vector<Mat<eT> > planes;
+  const ImageRGBRoi<eT> region = roi(image, 3, 5, image.height - 7, image.width - 11);
+  const ColorSpace spaces[] = { COLORSPACE_NORMALIZEDRGB, COLORSPACE_XYZ, COLORSPACE_LAB,
+                                COLORSPACE_HSV, COLORSPACE_YCBCR };
+  const ConversionMode modes[] = { CONVERSION_EXACT, CONVERSION_FAST };
+  for (const ConversionMode mode : modes) {
+    setConversionMode(mode);
+    for (const ColorSpace space : spaces) {
+      ImageNormalizedRGB<eT> normalizedRgb;
+      ImageXYZ<eT> xyz;
+      ImageLAB<eT> lab;
+      ImageHSV<eT> hsv;
+      ImageYCbCr<eT> yCbCr;
+      Image<eT>* const images[] = { NULL, &normalizedRgb, &xyz, &lab, &hsv, &yCbCr };
+      Image<eT>& converted = *images[space];
+      ImageRGB<eT> back;
+
+      convert(converted, image);
+      addPlanes(planes, converted);
+      convert(back, converted);
+      addPlanes(planes, back);
+      convert(converted, region);
+      addPlanes(planes, converted);
+    }
+  }
+  setConversionMode(CONVERSION_EXACT);
+
+  Mat<eT> gray;
+  convert(gray, image);
+  planes.push_back(gray);
+  convert(gray, region);
+  planes.push_back(gray);
+
+  Mat<eT> mask;
+  threshold(mask, image.g, (eT)100);
+  planes.push_back(mask);
+  threshold(mask, region.g, (eT)100, (eT)7, (eT)200);
+  planes.push_back(mask);
+  threshold(mask, image.b, vector<eT>{ (eT)50, (eT)100, (eT)200 }, vector<eT>{ (eT)0, (eT)1, (eT)2, (eT)3 });
+  planes.push_back(mask);
+  return planes;
+}
+
+template<typename eT>
+bool sameBits(const vector<Mat<eT> >& planes0, const vector<Mat<eT> >& planes1) {
+  if (planes0.size() != planes1.size())
+    return false;
+  for (size_t i = 0; i < planes0.size(); i++) {
+    if (planes0[i].n_rows != planes1[i].n_rows || planes0[i].n_cols != planes1[i].n_cols ||
+        memcmp(planes0[i].memptr(), planes1[i].memptr(), planes0[i].n_elem * sizeof(eT)) != 0)
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Tests.
+////////////////////////////////////////////////////////////////////////////////
+
+// Serial scalar results against 7 threads and against the best instruction
+// set of the CPU. Bands are small enough that 7 threads all get work.
+template<typename eT>
+void testThreadsAndSimd(const string& type) {
+  const ImageRGB<eT> image = randomImage<eT>(259, 131, 1);
+  setMinTilePixels(1024);
+
+  setThreadCount(1);
+  setSimdLevel(SIMD_SCALAR);
+  const vector<Mat<eT> > reference = convertAll(image);
+
+  setThreadCount(7);
+  check(sameBits(reference, convertAll(image)), type + ": 7 threads differ from 1 thread");
+
+  setThreadCount(1);
+  setSimdLevel(supportedSimdLevel());
+  check(sameBits(reference, convertAll(image)), type + ": SIMD kernels differ from scalar kernels");
+
+  setThreadCount(7);
+  check(sameBits(reference, convertAll(image)), type + ": SIMD kernels on 7 threads differ");
+
+  setThreadCount(1);
+  setMinTilePixels(65536);
+}
+
+// Scale and offset of the channels of integer images (see image.h).
+struct IntegerScale {
+  double scale[3];
+  double offset[3];
+};
+
+// Largest difference between an integer plane and a double-precision plane
+// scaled like it, ignoring the undefined normalized R'G'B' of black.
+template<typename eT>
+double maxError(const Mat<eT>& fixed, const Mat<double>& exact, const double scale, const double offset) {
+  double error = 0;
+  for (uword i = 0; i < fixed.n_elem; i++) {
+    if (std::isnan(exact[i]))
+      continue;
+    const double expected = std::min(std::max(exact[i] * scale + offset, 0.0), 255.0);
+    error = std::max(error, fabs(fixed[i] - expected));
+  }
+  return error;
+}
+
+// Fixed-point conversions of every 8-bit RGB color against the
+// double-precision ones, one red value at a time. The fixed-point results are
+// rounded, so they can be no closer than 0.5.
+template<typename eT>
+void testFixedPoint(const string& type) {
+  const double bound = 0.65;
+  const ColorSpace spaces[] = { COLORSPACE_NORMALIZEDRGB, COLORSPACE_XYZ, COLORSPACE_LAB,
+                                COLORSPACE_HSV, COLORSPACE_YCBCR };
+  const IntegerScale scales[] = {
+    { { 1, 1, 1 }, { 0, 0, 0 } },  // RGB, unused
+    { { 1, 1, 1 }, { 0, 0, 0 } },
+    { { 255 / 95.047, 255 / 100.0, 255 / 108.883 }, { 0, 0, 0 } },
+    { { 2.55, 1, 1 }, { 0, 128, 128 } },
+    { { 255, 255, 255 }, { 0, 0, 0 } },
+    { { 255, 255, 255 }, { 0, 128, 128 } }
+  };
+  const char* names[] = { "RGB", "normalized R'G'B'", "XYZ", "L*a*b*", "HSV", "Y'CbCr" };
+  double errors[6] = {};
+  double grayError = 0;
+
+  ImageRGB<eT> imageFixed(256, 256);
+  ImageRGB<double> imageExact(256, 256);
+  for (u32 r = 0; r < 256; r++) {
+    for (u32 b = 0; b < 256; b++) {
+      for (u32 g = 0; g < 256; g++) {
+        imageFixed.r(g, b) = imageExact.r(g, b) = r;
+        imageFixed.g(g, b) = imageExact.g(g, b) = g;
+        imageFixed.b(g, b) = imageExact.b(g, b) = b;
+      }
+    }
+
+    for (const ColorSpace space : spaces) {
+      ImageNormalizedRGB<eT> normalizedRgbFixed;
+      ImageXYZ<eT> xyzFixed;
+      ImageLAB<eT> labFixed;
+      ImageHSV<eT> hsvFixed;
+      ImageYCbCr<eT> yCbCrFixed;
+      Image<eT>* const imagesFixed[] = { NULL, &normalizedRgbFixed, &xyzFixed, &labFixed, &hsvFixed, &yCbCrFixed };
+      ImageNormalizedRGB<double> normalizedRgbExact;
+      ImageXYZ<double> xyzExact;
+      ImageLAB<double> labExact;
+      ImageHSV<double> hsvExact;
+      ImageYCbCr<double> yCbCrExact;
+      Image<double>* const imagesExact[] = { NULL, &normalizedRgbExact, &xyzExact, &labExact, &hsvExact,
+                                             &yCbCrExact };
+      convert(*imagesFixed[space], imageFixed);
+      convert(*imagesExact[space], imageExact);
+
+      Mat<eT>* planesFixed[3];
+      Mat<double>* planesExact[3];
+      imagePlanes(*imagesFixed[space], planesFixed[0], planesFixed[1], planesFixed[2]);
+      imagePlanes(*imagesExact[space], planesExact[0], planesExact[1], planesExact[2]);
+      for (u32 p = 0; p < 3; p++) {
+        errors[space] = std::max(errors[space], maxError(*planesFixed[p], *planesExact[p],
+                                                         scales[space].scale[p], scales[space].offset[p]));
+      }
+    }
+
+    Mat<eT> grayFixed;
+    Mat<double> grayExact;
+    convert(grayFixed, imageFixed);
+    convert(grayExact, imageExact);
+    grayError = std::max(grayError, maxError(grayFixed, grayExact, 1, 0));
+  }
+
+  for (const ColorSpace space : spaces)
+    check(errors[space] <= bound, type + ": fixed-point " + names[space] + " is off by " + to_string(errors[space]));
+  check(grayError <= bound, type + ": fixed-point grayscale is off by " + to_string(grayError));
+}
+
+int main() {
+  testThreadsAndSimd<u8>("u8");
+  testThreadsAndSimd<float>("float");
+  testThreadsAndSimd<double>("double");
+  testFixedPoint<u8>("u8");
+  testFixedPoint<u16>("u16");
+
+  if (failures > 0) {
+    cerr << failures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Checks of the SENSE image conversions. Run with "make check".
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+CONFIG   += console c++11 thread testcase link_pkgconfig
+CONFIG   -= app_bundle
+
+# Same floating-point flags as the application (see simd.h).
+QMAKE_CXXFLAGS += -ffp-contract=off -fno-trapping-math
+
+TARGET = conversiontest
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+PKGCONFIG += Magick++
+LIBS += -larmadillo
+
+SOURCES += conversiontest.cpp
@@ -0,0 +1,218 @@
+#include "thumbnailcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <algorithm>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+static QString thumbnailCacheDir()
+{
+#if QT_VERSION >= 0x050000
+    const QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    const QString base = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+    return base + "/thumbnails";
+}
+
+//Last use of a cached thumbnail, as far as the file system keeps track of
+//reads; files it does not record reads of count as used when written
+static QDateTime lastUsed(const QFileInfo &info)
+{
+    const QDateTime read = info.lastRead();
+    const QDateTime written = info.lastModified();
+    return read.isValid() && read > written ? read : written;
+}
+
+static bool usedBefore(const QFileInfo &a, const QFileInfo &b)
+{
+    return lastUsed(a) < lastUsed(b);
+}
+
+ThumbnailLoader::ThumbnailLoader(const QString &cacheDir, int size, qint64 maxBytes, QObject *parent) :
+    QObject(parent),
+    cacheDir(cacheDir),
+    size(size),
+    maxBytes(maxBytes),
+    cacheBytes(0),
+    running(false)
+{
+}
+
+void ThumbnailLoader::add(const QStringList &paths)
+{
+    QMutexLocker locker(&mutex);
+    foreach(const QString &path, paths)
+    {
+        if(pending.contains(path))
+            continue;
+        pending.insert(path);
+        queue << path;
+    }
+
+    if(!running && !pending.isEmpty())
+    {
+        running = true;
+        QMetaObject::invokeMethod(this, "loadQueue", Qt::QueuedConnection);
+    }
+}
+
+void ThumbnailLoader::prioritize(const QStringList &paths)
+{
+    //Prioritized paths stay in the queue too; they are skipped there once
+    //they are no longer pending
+    QMutexLocker locker(&mutex);
+    priority.clear();
+    foreach(const QString &path, paths)
+    {
+        if(pending.contains(path))
+            priority << path;
+    }
+}
+
+void ThumbnailLoader::clear()
+{
+    QMutexLocker locker(&mutex);
+    queue.clear();
+    priority.clear();
+    pending.clear();
+}
+
+bool ThumbnailLoader::takeNext(QString &path)
+{
+    QMutexLocker locker(&mutex);
+    while(!priority.isEmpty())
+    {
+        path = priority.takeFirst();
+        if(pending.remove(path))
+            return true;
+    }
+    while(!queue.isEmpty())
+    {
+        path = queue.takeFirst();
+        if(pending.remove(path))
+            return true;
+    }
+    running = false;
+    return false;
+}
+
+void ThumbnailLoader::loadQueue()
+{
+    QString path;
+    while(takeNext(path))
+        emit loaded(path, makeThumbnail(path));
+}
+
+QImage ThumbnailLoader::makeThumbnail(const QString &path)
+{
+    //An edited or replaced image gets a new key, so stale thumbnails are
+    //never used
+    const QFileInfo info(path);
+    const QByteArray key = info.absoluteFilePath().toUtf8() + '\n'
+                         + QByteArray::number(info.size()) + '\n'
+                         + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + '\n'
+                         + QByteArray::number(size);
+    const QString cachePath = cacheDir + "/"
+                            + QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex() + ".png";
+
+    QImage thumbnail;
+    if(thumbnail.load(cachePath, "PNG"))
+        return thumbnail;
+
+    //Let the decoder scale while decoding, which for JPEG skips most of the
+    //work of a full decode
+    QImageReader reader(path);
+    const QSize imageSize = reader.size();
+    if(imageSize.isValid() && (imageSize.width() > size || imageSize.height() > size))
+        reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+    thumbnail = reader.read();
+    if(thumbnail.isNull())
+        return thumbnail;
+
+    //Images whose size is unknown up front are scaled after decoding
+    if(thumbnail.width() > size || thumbnail.height() > size)
+        thumbnail = thumbnail.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    //Write to a temporary file first so that a partial thumbnail is never
+    //read back
+    const QString tempPath = cachePath + ".tmp";
+    if(thumbnail.save(tempPath, "PNG"))
+    {
+        QFile::remove(cachePath);
+        QFile::rename(tempPath, cachePath);
+        cacheBytes += QFileInfo(cachePath).size();
+        if(cacheBytes > maxBytes)
+            trimCache();
+    }
+    return thumbnail;
+}
+
+void ThumbnailLoader::trimCache()
+{
+    //Remove the least recently used thumbnails, and temporary files left by
+    //a crash, down to 3/4 of the limit, so that the cache directory is listed
+    //again only after many more thumbnails have been written
+    QFileInfoList files = QDir(cacheDir).entryInfoList(QStringList() << "*.png" << "*.tmp", QDir::Files);
+    cacheBytes = 0;
+    foreach(const QFileInfo &info, files)
+        cacheBytes += info.size();
+    if(cacheBytes <= maxBytes)
+        return;
+
+    std::sort(files.begin(), files.end(), usedBefore);
+    const qint64 targetBytes = maxBytes / 4 * 3;
+    for(int i = 0; i < files.size() && cacheBytes > targetBytes; i++)
+    {
+        if(QFile::remove(files[i].absoluteFilePath()))
+            cacheBytes -= files[i].size();
+    }
+}
+
+ThumbnailCache::ThumbnailCache(int size, qint64 maxBytes, QObject *parent) :
+    QObject(parent)
+{
+    const QString cacheDir = thumbnailCacheDir();
+    QDir().mkpath(cacheDir);
+
+    loader = new ThumbnailLoader(cacheDir, size, maxBytes);
+    loader->moveToThread(&thread);
+    connect(loader, SIGNAL(loaded(QString,QImage)), this, SIGNAL(thumbnailReady(QString,QImage)));
+    thread.start(QThread::LowPriority);
+
+    //Measure the cache, trimming what earlier runs left over the limit,
+    //before the first thumbnail is made
+    QMetaObject::invokeMethod(loader, "trimCache", Qt::QueuedConnection);
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    loader->clear();
+    thread.quit();
+    thread.wait();
+    delete loader;
+}
+
+void ThumbnailCache::load(const QStringList &paths)
+{
+    loader->add(paths);
+}
+
+void ThumbnailCache::prioritize(const QStringList &paths)
+{
+    loader->prioritize(paths);
+}
+
+void ThumbnailCache::clear()
+{
+    loader->clear();
+}
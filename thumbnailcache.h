@@ -0,0 +1,83 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+// Makes thumbnails on the thread it lives in, one at a time, the prioritized
+// ones first and the others in the order they are requested. Thumbnails are
+// read from the cache directory when they are there, otherwise decoded at
+// reduced size and written to it. The least recently used thumbnails are
+// removed when the cache directory grows over maxBytes.
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    ThumbnailLoader(const QString &cacheDir, int size, qint64 maxBytes, QObject *parent = 0);
+
+    void add(const QStringList &paths);
+    void prioritize(const QStringList &paths);
+    void clear();
+
+signals:
+    void loaded(const QString &path, const QImage &thumbnail);
+
+private slots:
+    void loadQueue();
+    void trimCache();
+
+private:
+    const QString cacheDir;
+    const int     size;
+    const qint64  maxBytes;
+    qint64        cacheBytes;   // Size of the cache directory, on the loader thread
+
+    QMutex        mutex;        // Protects the members below
+    QStringList   queue;        // Requested paths, some of them made already
+    QStringList   priority;     // Paths to make before the rest of the queue
+    QSet<QString> pending;      // Requested paths not made yet
+    bool          running;
+
+    bool   takeNext(QString &path);
+    QImage makeThumbnail(const QString &path);
+};
+
+// Thumbnails of images, no larger than size x size, made on a worker thread.
+// They are kept on disk under the cache location of the user, keyed by the
+// path, size and modification time of the image, so that they are made only
+// once, and the least recently used ones are removed when they take more
+// than maxBytes. thumbnailReady() is emitted when one is available; a null
+// image means the image could not be read.
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    ThumbnailCache(int size, qint64 maxBytes, QObject *parent = 0);
+    ~ThumbnailCache();
+
+    // Make thumbnails of paths after those requested before
+    void load(const QStringList &paths);
+
+    // Make the thumbnails of paths that are not done yet before the others,
+    // in this order. Replaces the paths prioritized before.
+    void prioritize(const QStringList &paths);
+
+    // Drop the requests that are not done yet
+    void clear();
+
+signals:
+    void thumbnailReady(const QString &path, const QImage &thumbnail);
+
+private:
+    QThread          thread;
+    ThumbnailLoader *loader;
+};
+
+#endif // THUMBNAILCACHE_H